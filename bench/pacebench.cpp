@@ -0,0 +1,49 @@
+// Keystroke pacing: how close the pauses between submissions come to the
+// configured delay. Sleeps for real, so the time per iteration is mostly the
+// intervals themselves; the counters are what matters.
+// Run: KeyGhostBench --benchmark_filter=Pace
+
+#include "pacer.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// Pauses per iteration, as in typing a 100-character snippet
+const int Pauses = 100;
+
+} // namespace
+
+static void BM_PaceInterval(benchmark::State &state)
+{
+    Pacer pacer;
+    const qint64 intervalUs = state.range(0);
+    double jitter = 0;
+    double maxLate = 0;
+    double rate = 0;
+
+    for (auto _ : state) {
+        pacer.begin();
+        const qint64 started = Pacer::nowNs();
+        for (int i = 0; i < Pauses; i++) {
+            pacer.wait(intervalUs);
+        }
+        const qint64 elapsed = Pacer::nowNs() - started;
+
+        PacingStats stats = pacer.stats();
+        jitter = qMax(jitter, stats.jitterUs);
+        maxLate = qMax(maxLate, stats.maxLateUs);
+        rate = Pauses * 1e9 / double(elapsed);
+    }
+
+    // Achieved against requested submissions per second
+    state.counters["rate"] = rate;
+    state.counters["target_rate"] = 1e6 / double(intervalUs);
+    state.counters["jitter_us"] = jitter;
+    state.counters["max_late_us"] = maxLate;
+}
+BENCHMARK(BM_PaceInterval)
+    ->ArgName("interval_us")
+    ->Arg(100)->Arg(500)->Arg(1000)->Arg(5000)
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
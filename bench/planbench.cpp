@@ -0,0 +1,91 @@
+// Work done on the way to sendText: expanding a snippet template and
+// compiling the text into keystrokes. Nothing is typed.
+// Run: KeyGhostBench --benchmark_filter=Plan
+
+#include "injectionbackend.h"
+#include "snippettemplate.h"
+#include <benchmark/benchmark.h>
+
+#if defined(Q_OS_WIN)
+#include "wininputbackend.h"
+using PlatformBackend = WinInputBackend;
+#else
+#include "uinputbackend.h"
+using PlatformBackend = UinputBackend;
+#endif
+
+namespace {
+
+// Mostly ASCII with some characters no US key produces
+QString sampleText(qsizetype size)
+{
+    static const QString pattern = QString::fromUtf8("Hello, World! 123 {x} éß€\n");
+    QString text;
+    text.reserve(size);
+    while (text.size() < size) {
+        text += pattern.left(size - text.size());
+    }
+    return text;
+}
+
+} // namespace
+
+// Per-character planning of a text that isn't cached yet
+static void BM_PlanCompile(benchmark::State &state)
+{
+    PlatformBackend backend;
+    QString text = sampleText(state.range(0));
+    quint64 layout = backend.layoutId();
+    KeystrokePlan plan;
+
+    for (auto _ : state) {
+        backend.compile(text, layout, plan);
+        benchmark::DoNotOptimize(plan.strokes.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * qsizetype(sizeof(QChar)));
+}
+BENCHMARK(BM_PlanCompile)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+// Snippet without placeholders: expanding hands back the parsed text
+static void BM_PlanExpandPlain(benchmark::State &state)
+{
+    SnippetTemplate compiled(SecretBuffer::share(sampleText(state.range(0))));
+
+    for (auto _ : state) {
+        SnippetTemplate::Expansion expansion = compiled.expand();
+        benchmark::DoNotOptimize(expansion.text.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * qsizetype(sizeof(QChar)));
+}
+BENCHMARK(BM_PlanExpandPlain)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+// Snippet with a date, an environment variable and a cursor around the text
+static void BM_PlanExpandTemplate(benchmark::State &state)
+{
+    SnippetTemplate compiled(SecretBuffer::share(
+        "{date:yyyy-MM-dd} {env:HOME} " + sampleText(state.range(0)) + "{cursor};"));
+
+    for (auto _ : state) {
+        SnippetTemplate::Expansion expansion = compiled.expand();
+        benchmark::DoNotOptimize(expansion.text.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * qsizetype(sizeof(QChar)));
+}
+BENCHMARK(BM_PlanExpandTemplate)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+// Parsing a template, done once when a text is decrypted or edited
+static void BM_PlanParseTemplate(benchmark::State &state)
+{
+    SecretText text = SecretBuffer::share("{date} " + sampleText(state.range(0)) + " {clipboard}");
+
+    for (auto _ : state) {
+        SnippetTemplate compiled(text);
+        benchmark::DoNotOptimize(&compiled);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * qsizetype(sizeof(QChar)));
+}
+BENCHMARK(BM_PlanParseTemplate)->RangeMultiplier(8)->Range(8, 1 << 20);
@@ -0,0 +1,132 @@
+// Vault persistence on synthetic vaults of 10 to 100k snippets: what
+// loadSnippets reads at startup, what a save after one edit writes, and
+// opening a single text on first use.
+// Run: KeyGhostBench --benchmark_filter=Vault
+
+#include "snippetwriter.h"
+#include "vaultcrypto.h"
+#include "vaultfile.h"
+#include <QTemporaryDir>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// Texts of the other snippets in a synthetic vault
+const int FillerTextSize = 64;
+
+// Writes count snippets with names, tags and sealed texts to dir/snippets.kgv
+QString writeSyntheticVault(const QTemporaryDir &dir, const VaultCrypto &crypto, int count)
+{
+    QString path = dir.filePath("snippets.kgv");
+    QByteArray sealed = crypto.encrypt(QByteArray(FillerTextSize, 'x'));
+
+    QList<VaultRecord> records;
+    records.reserve(count);
+    for (int i = 0; i < count; i++) {
+        VaultRecord record;
+        record.id = i + 1;
+        record.name = QString("Snippet %1").arg(i + 1);
+        record.hotkeyModifiers = 0x0001;
+        record.hotkeyKey = 0x31 + i % 9;
+        record.tags = QStringList{ "bench", QString("group%1").arg(i % 100) };
+        record.body = sealed;
+        records.append(record);
+    }
+
+    VaultFile vault(path);
+    vault.save(records);
+    return path;
+}
+
+void vaultSizes(benchmark::internal::Benchmark *bench)
+{
+    bench->ArgName("snippets")->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+// Startup: map the file and build the in-memory index
+static void BM_VaultLoad(benchmark::State &state)
+{
+    QTemporaryDir dir;
+    VaultCrypto crypto(VaultCrypto::defaultKey());
+    QString path = writeSyntheticVault(dir, crypto, int(state.range(0)));
+
+    for (auto _ : state) {
+        VaultFile vault(path);
+        bool ok = vault.load();
+        QList<VaultRecord> index = vault.index();
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(index.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VaultLoad)->Apply(vaultSizes);
+
+// A save after editing one snippet's text; every other body is copied as is
+static void BM_VaultSaveOneText(benchmark::State &state)
+{
+    QTemporaryDir dir;
+    VaultCrypto crypto(VaultCrypto::defaultKey());
+    VaultFile vault(writeSyntheticVault(dir, crypto, int(state.range(0))));
+    vault.load();
+    SnippetWriter writer(&vault, &crypto);
+
+    SnippetRecord changed;
+    changed.id = 1;
+    changed.name = "Snippet 1";
+    changed.hotkeyModifiers = 0x0001;
+    changed.hotkeyKey = 0x31;
+    changed.text = SecretBuffer::share(QString(int(state.range(1)), QChar('x')));
+    changed.textChanged = true;
+
+    int generation = 0;
+    for (auto _ : state) {
+        writer.write({ changed }, {}, ++generation);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VaultSaveOneText)
+    ->ArgNames({ "snippets", "text" })
+    ->ArgsProduct({ benchmark::CreateRange(10, 100000, 10), { 8, 1024, 1 << 20 } })
+    ->Unit(benchmark::kMillisecond);
+
+// Saving every record, as a settings import or a full rewrite does
+static void BM_VaultSaveAll(benchmark::State &state)
+{
+    QTemporaryDir dir;
+    VaultCrypto crypto(VaultCrypto::defaultKey());
+    VaultFile vault(writeSyntheticVault(dir, crypto, int(state.range(0))));
+    vault.load();
+
+    for (auto _ : state) {
+        bool ok = vault.save(vault.index());
+        benchmark::DoNotOptimize(ok);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VaultSaveAll)->Apply(vaultSizes);
+
+// First use of a snippet: copy its body out of the mapping and decrypt it
+static void BM_VaultOpenText(benchmark::State &state)
+{
+    QTemporaryDir dir;
+    VaultCrypto crypto(VaultCrypto::defaultKey());
+    VaultFile vault(writeSyntheticVault(dir, crypto, int(state.range(0))));
+    vault.load();
+
+    const int count = int(state.range(0));
+    int id = 0;
+    QByteArray plain;
+    for (auto _ : state) {
+        id = id % count + 1;
+        bool ok = crypto.decrypt(vault.body(id), plain);
+        benchmark::DoNotOptimize(ok);
+    }
+
+    state.SetBytesProcessed(state.iterations() * FillerTextSize);
+}
+BENCHMARK(BM_VaultOpenText)->ArgName("snippets")->RangeMultiplier(10)->Range(10, 100000);
@@ -0,0 +1,103 @@
+#include "appconfig.h"
+#include <QSettings>
+
+QString AppSettings::deliveryName(Delivery delivery)
+{
+    switch (delivery) {
+    case DeliverType: return "Type";
+    case DeliverPaste: return "Paste";
+    case DeliverCopy: return "Copy";
+    case DeliverAuto: break;
+    }
+    return "Auto";
+}
+
+AppSettings::Delivery AppSettings::deliveryFromName(const QString &name)
+{
+    if (name == "Type") return DeliverType;
+    if (name == "Paste") return DeliverPaste;
+    if (name == "Copy") return DeliverCopy;
+    return DeliverAuto;
+}
+
+AppConfig::AppConfig(QObject *parent)
+    : QObject(parent)
+    , current(read())
+{
+    writer.setMaxThreadCount(1);
+}
+
+AppConfig::~AppConfig()
+{
+    writer.waitForDone();
+}
+
+void AppConfig::update(const AppSettings &values)
+{
+    current = values;
+    emit changed();
+
+    // The snapshot travels with the task, the fields are only touched here
+    writer.start([values]() {
+        QSettings settings;
+        settings.setValue("MaskText", values.maskText);
+        settings.setValue("AutoClear", values.autoClear);
+        settings.setValue("ForgetTextAfter", values.forgetTextAfter);
+        settings.setValue("Delivery", AppSettings::deliveryName(values.delivery));
+        settings.setValue("PasteThreshold", values.pasteThreshold);
+        settings.remove("UseClipboard");
+        settings.setValue("ClearClipboard", values.clearClipboard);
+        settings.setValue("ClipboardClearDelay", values.clipboardClearDelay);
+        settings.setValue("TypingDelay", values.typingDelay);
+        settings.setValue("BurstMode", values.burstMode);
+        settings.setValue("BurstChunkSize", values.burstChunkSize);
+        settings.setValue("BurstChunkDelay", values.burstChunkDelay);
+        settings.setValue("PaletteHotkey", values.paletteHotkey);
+        settings.setValue("DirectFire", values.directFire);
+        settings.setValue("SequenceTimeout", values.sequenceTimeout);
+        settings.sync();
+        if (settings.status() != QSettings::NoError) {
+            qWarning("Failed to save the settings");
+        }
+    });
+}
+
+void AppConfig::reset()
+{
+    current = AppSettings();
+    emit changed();
+
+    // Cleared before returning, so a crash right after can't bring it back
+    writer.waitForDone();
+    QSettings settings;
+    settings.clear();
+    settings.sync();
+}
+
+AppSettings AppConfig::read()
+{
+    QSettings settings;
+    AppSettings defaults;
+    AppSettings values;
+    values.maskText = settings.value("MaskText", defaults.maskText).toBool();
+    values.autoClear = settings.value("AutoClear", defaults.autoClear).toBool();
+    values.forgetTextAfter = settings.value("ForgetTextAfter", defaults.forgetTextAfter).toInt();
+    // Older versions only had UseClipboard
+    if (settings.contains("Delivery")) {
+        values.delivery = AppSettings::deliveryFromName(settings.value("Delivery").toString());
+    } else if (settings.value("UseClipboard", false).toBool()) {
+        values.delivery = AppSettings::DeliverCopy;
+    }
+    values.pasteThreshold = settings.value("PasteThreshold", defaults.pasteThreshold).toInt();
+    values.clearClipboard = settings.value("ClearClipboard", defaults.clearClipboard).toBool();
+    values.clipboardClearDelay = settings.value("ClipboardClearDelay", defaults.clipboardClearDelay).toInt();
+    values.typingDelay = settings.value("TypingDelay", defaults.typingDelay).toDouble();
+    values.burstMode = settings.value("BurstMode", defaults.burstMode).toBool();
+    values.burstChunkSize = settings.value("BurstChunkSize", defaults.burstChunkSize).toInt();
+    values.burstChunkDelay = settings.value("BurstChunkDelay", defaults.burstChunkDelay).toDouble();
+    values.paletteHotkey = settings.value("PaletteHotkey", defaults.paletteHotkey).toString();
+    values.directFire = settings.value("DirectFire", defaults.directFire).toBool();
+    values.sequenceTimeout = settings.value("SequenceTimeout", defaults.sequenceTimeout).toInt();
+    values.injectionBackend = settings.value("InjectionBackend").toString();
+    return values;
+}
@@ -0,0 +1,69 @@
+#ifndef APPCONFIG_H
+#define APPCONFIG_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+// Every user setting as a plain field, with its default
+struct AppSettings
+{
+    enum Delivery {
+        DeliverAuto,    // Paste long texts, type short ones
+        DeliverType,
+        DeliverPaste,
+        DeliverCopy     // Leave the pasting to the user
+    };
+
+    bool maskText = false;
+    bool autoClear = false;
+    int forgetTextAfter = 60;           // Seconds, 0 keeps decrypted texts
+    Delivery delivery = DeliverAuto;
+    int pasteThreshold = 200;           // Characters from which Auto pastes
+    bool clearClipboard = false;
+    int clipboardClearDelay = 30;       // Seconds
+    double typingDelay = 30;            // ms, fractions down to a microsecond
+    bool burstMode = false;
+    int burstChunkSize = 64;
+    double burstChunkDelay = 0;         // ms
+    QString paletteHotkey = "Ctrl+Alt+Space";
+    bool directFire = true;
+    int sequenceTimeout = 1000;         // ms
+    QString injectionBackend;           // Read only, empty picks one for the platform
+
+    static QString deliveryName(Delivery delivery);
+    static Delivery deliveryFromName(const QString &name);
+};
+
+// The settings, read from QSettings once at startup. Sends and the
+// settings dialog read the fields directly; changes are written back on a
+// background thread so the registry or INI file is never touched on the
+// GUI thread after startup.
+class AppConfig : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AppConfig(QObject *parent = nullptr);
+    // Waits for pending writes
+    ~AppConfig();
+
+    const AppSettings &values() const { return current; }
+
+    // Replaces every setting, emits changed() and saves in the background
+    void update(const AppSettings &values);
+
+    // Back to the defaults; removes everything from QSettings, snippets included
+    void reset();
+
+signals:
+    void changed();
+
+private:
+    static AppSettings read();
+
+    AppSettings current;
+    QThreadPool writer;     // One thread, so writes land in order
+};
+
+#endif // APPCONFIG_H
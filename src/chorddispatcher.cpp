@@ -0,0 +1,288 @@
+#include "chorddispatcher.h"
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+// The hook procedure has no user pointer; only one sequence can be pending
+ChordDispatcher *hookOwner = nullptr;
+HHOOK keyboardHook = nullptr;
+
+bool isModifierKey(DWORD vk)
+{
+    switch (vk) {
+    case VK_SHIFT: case VK_LSHIFT: case VK_RSHIFT:
+    case VK_CONTROL: case VK_LCONTROL: case VK_RCONTROL:
+    case VK_MENU: case VK_LMENU: case VK_RMENU:
+    case VK_LWIN: case VK_RWIN:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Virtual key to the Qt key code that QKeySequenceEdit recorded; 0 if unknown
+int storedKey(DWORD vk)
+{
+    if ((vk >= 'A' && vk <= 'Z') || (vk >= '0' && vk <= '9')) return int(vk);
+    if (vk >= VK_F1 && vk <= VK_F24) return Qt::Key_F1 + int(vk - VK_F1);
+
+    switch (vk) {
+    case VK_SPACE: return Qt::Key_Space;
+    case VK_RETURN: return Qt::Key_Return;
+    case VK_TAB: return Qt::Key_Tab;
+    case VK_BACK: return Qt::Key_Backspace;
+    case VK_LEFT: return Qt::Key_Left;
+    case VK_RIGHT: return Qt::Key_Right;
+    case VK_UP: return Qt::Key_Up;
+    case VK_DOWN: return Qt::Key_Down;
+    case VK_HOME: return Qt::Key_Home;
+    case VK_END: return Qt::Key_End;
+    case VK_INSERT: return Qt::Key_Insert;
+    case VK_DELETE: return Qt::Key_Delete;
+    case VK_PRIOR: return Qt::Key_PageUp;
+    case VK_NEXT: return Qt::Key_PageDown;
+    }
+
+    // Punctuation: Qt uses the unshifted character
+    UINT c = MapVirtualKeyW(vk, MAPVK_VK_TO_CHAR) & 0x7FFF;
+    return c >= 0x20 && c < 0x7F ? int(QChar(c).toUpper().unicode()) : 0;
+}
+
+int heldModifiers()
+{
+    int modifiers = 0;
+    if (GetAsyncKeyState(VK_MENU) & 0x8000) modifiers |= MOD_ALT;
+    if (GetAsyncKeyState(VK_CONTROL) & 0x8000) modifiers |= MOD_CONTROL;
+    if (GetAsyncKeyState(VK_SHIFT) & 0x8000) modifiers |= MOD_SHIFT;
+    if ((GetAsyncKeyState(VK_LWIN) | GetAsyncKeyState(VK_RWIN)) & 0x8000) modifiers |= MOD_WIN;
+    return modifiers;
+}
+
+LRESULT CALLBACK keyboardProc(int code, WPARAM wParam, LPARAM lParam)
+{
+    if (code == HC_ACTION && hookOwner && (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN)) {
+        const KBDLLHOOKSTRUCT *event = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+        // Leave injected input alone, including our own typing
+        if (!(event->flags & LLKHF_INJECTED) && !isModifierKey(event->vkCode)) {
+            if (event->vkCode == VK_ESCAPE) {
+                hookOwner->cancel();
+                return 1;
+            }
+            int key = storedKey(event->vkCode);
+            if (key != 0 && hookOwner->feed(heldModifiers(), key)) {
+                return 1;
+            }
+        }
+    }
+    return CallNextHookEx(nullptr, code, wParam, lParam);
+}
+#endif
+
+} // namespace
+
+ChordDispatcher::ChordDispatcher(QObject *parent)
+    : QObject(parent), pending(nullptr)
+{
+    timeout.setSingleShot(true);
+    timeout.setInterval(1000);
+    connect(&timeout, &QTimer::timeout, this, &ChordDispatcher::cancel);
+}
+
+ChordDispatcher::~ChordDispatcher()
+{
+    removeHook();
+    clear();
+}
+
+quint64 ChordDispatcher::chordKey(int modifiers, int key)
+{
+    return (quint64(quint32(modifiers)) << 32) | quint32(key);
+}
+
+int ChordDispatcher::firstId(const Node *node)
+{
+    while (node->id < 0 && !node->children.isEmpty()) {
+        node = *node->children.cbegin();
+    }
+    return node->id;
+}
+
+int ChordDispatcher::insert(int id, const QList<Chord> &sequence)
+{
+    remove(id);
+    if (sequence.size() < 2) return -1;
+
+    // Walk the existing path first so a clash leaves the trie untouched
+    Node *node = &root;
+    qsizetype depth = 0;
+    for (; depth < sequence.size(); depth++) {
+        Node *child = node->children.value(chordKey(sequence[depth].modifiers, sequence[depth].key));
+        if (!child) break;
+        if (child->id >= 0) return child->id;  // A shorter sequence already ends here
+        node = child;
+    }
+    if (depth == sequence.size()) {
+        return firstId(node);                   // A longer sequence runs through here
+    }
+
+    quint64 leader = chordKey(sequence[0].modifiers, sequence[0].key);
+    if (depth == 0 && !leaders.contains(leader)) {
+        qsizetype slot = leaders.indexOf(0);
+        if (slot < 0) {
+            if (leaders.size() >= MaxLeaders) return NoLeaderSlot;
+            leaders.append(leader);
+        } else {
+            leaders[slot] = leader;
+        }
+    }
+
+    for (; depth < sequence.size(); depth++) {
+        Node *child = new Node;
+        child->parent = node;
+        child->chord = chordKey(sequence[depth].modifiers, sequence[depth].key);
+        node->children.insert(child->chord, child);
+        node = child;
+    }
+    node->id = id;
+    nodeById.insert(id, node);
+    return -1;
+}
+
+int ChordDispatcher::remove(int id)
+{
+    Node *node = nodeById.take(id);
+    if (!node) return -1;
+
+    if (pending) cancel();
+
+    // Prune the branch back to the first node still in use
+    node->id = -1;
+    while (node != &root && node->id < 0 && node->children.isEmpty()) {
+        Node *parent = node->parent;
+        parent->children.remove(node->chord);
+        if (parent == &root) {
+            qsizetype slot = leaders.indexOf(node->chord);
+            delete node;
+            if (slot >= 0) {
+                leaders[slot] = 0;
+                return int(slot);
+            }
+            return -1;
+        }
+        delete node;
+        node = parent;
+    }
+    return -1;
+}
+
+void ChordDispatcher::clear()
+{
+    cancel();
+
+    QList<Node*> stack(root.children.cbegin(), root.children.cend());
+    while (!stack.isEmpty()) {
+        Node *node = stack.takeLast();
+        for (Node *child : std::as_const(node->children)) {
+            stack.append(child);
+        }
+        delete node;
+    }
+    root.children.clear();
+    nodeById.clear();
+    leaders.clear();
+}
+
+int ChordDispatcher::leaderIndex(int modifiers, int key) const
+{
+    return int(leaders.indexOf(chordKey(modifiers, key)));
+}
+
+ChordDispatcher::Chord ChordDispatcher::leaderAt(int index) const
+{
+    quint64 leader = leaders.value(index, 0);
+    return { int(leader >> 32), int(quint32(leader)) };
+}
+
+bool ChordDispatcher::begin(int leaderIndex)
+{
+    quint64 leader = leaders.value(leaderIndex, 0);
+    Node *node = leader ? root.children.value(leader) : nullptr;
+    if (!node) return false;
+
+    bool wasPending = pending != nullptr;
+    pending = node;
+    timeout.start();
+    installHook();
+    if (!wasPending) emit pendingChanged(true);
+    return true;
+}
+
+void ChordDispatcher::cancel()
+{
+    if (!pending) return;
+    finish();
+}
+
+bool ChordDispatcher::feed(int modifiers, int key)
+{
+    if (!pending) return false;
+
+    Node *next = pending->children.value(chordKey(modifiers, key));
+    if (!next) {
+        // Not part of any sequence: give the key back to the application
+        cancel();
+        return false;
+    }
+
+    if (next->id >= 0) {
+        // Typing starts from the event loop, not inside the hook callback,
+        // which Windows times out after a few hundred milliseconds
+        int id = next->id;
+        finish();
+        QMetaObject::invokeMethod(this, [this, id]() { emit matched(id); }, Qt::QueuedConnection);
+    } else {
+        pending = next;
+        timeout.start();
+    }
+    return true;
+}
+
+void ChordDispatcher::finish()
+{
+    pending = nullptr;
+    timeout.stop();
+    removeHook();
+    emit pendingChanged(false);
+}
+
+void ChordDispatcher::installHook()
+{
+#ifdef Q_OS_WIN
+    hookOwner = this;
+    if (!keyboardHook) {
+        keyboardHook = SetWindowsHookExW(WH_KEYBOARD_LL, keyboardProc, GetModuleHandleW(nullptr), 0);
+        if (!keyboardHook) {
+            qWarning("Failed to install the keyboard hook for hotkey sequences");
+        }
+    }
+#endif
+}
+
+void ChordDispatcher::removeHook()
+{
+#ifdef Q_OS_WIN
+    // The hook only lives while a sequence is pending, so ordinary typing
+    // never goes through it
+    if (keyboardHook) {
+        UnhookWindowsHookEx(keyboardHook);
+        keyboardHook = nullptr;
+    }
+    if (hookOwner == this) {
+        hookOwner = nullptr;
+    }
+#endif
+}
@@ -0,0 +1,84 @@
+#ifndef CHORDDISPATCHER_H
+#define CHORDDISPATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+
+// Matches hotkey sequences such as "Alt+K, P". Only the first chord of a
+// sequence (the leader) is a global hotkey; once it fires, the following
+// keys are read from a low-level keyboard hook and walked through a prefix
+// trie, one hash lookup per key however many sequences exist. The sequence
+// is dropped if the next key doesn't arrive within the timeout.
+//
+// Chords use the same values as single hotkeys: MOD_* modifiers and the
+// stored key code.
+class ChordDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MaxLeaders = 256;
+    static const int NoLeaderSlot = -2;
+
+    explicit ChordDispatcher(QObject *parent = nullptr);
+    ~ChordDispatcher();
+
+    struct Chord
+    {
+        int modifiers;
+        int key;
+    };
+
+    // Adds a sequence of two or more chords for id. Returns -1 on success,
+    // NoLeaderSlot when MaxLeaders different leaders are in use, otherwise
+    // the id of the sequence that is equal to, a prefix of, or extends this one.
+    int insert(int id, const QList<Chord> &sequence);
+
+    // Removes id's sequence. Returns the index of a leader that no longer
+    // starts any sequence, or -1.
+    int remove(int id);
+    void clear();
+
+    // Slot of the leader chord, stable while sequences use it; -1 if unused
+    int leaderIndex(int modifiers, int key) const;
+    Chord leaderAt(int index) const;
+
+    // Starts matching after the leader's global hotkey fired
+    bool begin(int leaderIndex);
+    void cancel();
+    bool isPending() const { return pending != nullptr; }
+
+    // Steps the pending sequence. Returns true if the key was consumed.
+    bool feed(int modifiers, int key);
+
+    void setTimeout(int ms) { timeout.setInterval(ms); }
+
+signals:
+    void matched(int id);
+    void pendingChanged(bool pending);
+
+private:
+    struct Node
+    {
+        QHash<quint64, Node*> children;
+        Node *parent = nullptr;
+        quint64 chord = 0;
+        int id = -1;
+    };
+
+    static quint64 chordKey(int modifiers, int key);
+    static int firstId(const Node *node);
+    void finish();
+    void installHook();
+    void removeHook();
+
+    Node root;
+    QHash<int, Node*> nodeById;
+    QList<quint64> leaders;     // Slot -> leader chord, 0 when free
+    Node *pending;
+    QTimer timeout;
+};
+
+#endif // CHORDDISPATCHER_H
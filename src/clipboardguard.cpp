@@ -0,0 +1,121 @@
+#include "clipboardguard.h"
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QMimeData>
+#include <QRandomGenerator>
+#include <QTimer>
+
+namespace {
+
+const char TagFormat[] = "application/x-keyghost-tag";
+
+} // namespace
+
+ClipboardGuard::ClipboardGuard(QObject *parent)
+    : QObject(parent)
+    , snapshot(nullptr)
+{
+    restoreTimer = new QTimer(this);
+    restoreTimer->setSingleShot(true);
+    connect(restoreTimer, &QTimer::timeout, this, &ClipboardGuard::restore);
+}
+
+ClipboardGuard::~ClipboardGuard()
+{
+    // Don't leave the snippet behind in place of the user's clipboard
+    if (restoreTimer->isActive()) {
+        restore();
+    }
+    delete snapshot;
+}
+
+void ClipboardGuard::copy(const QString &text)
+{
+    restoreTimer->stop();
+    delete snapshot;
+    snapshot = nullptr;
+    QGuiApplication::clipboard()->setMimeData(tagged(text));
+}
+
+void ClipboardGuard::stash(const QString &text)
+{
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    restoreTimer->stop();
+
+    // Pasting again before the restore keeps the snapshot from before the first paste
+    if (!snapshot || !holdsOurs()) {
+        delete snapshot;
+        snapshot = new QMimeData;
+        if (const QMimeData *current = clipboard->mimeData()) {
+            const QStringList formats = current->formats();
+            for (const QString &format : formats) {
+                snapshot->setData(format, current->data(format));
+            }
+        }
+    }
+
+    clipboard->setMimeData(tagged(text));
+}
+
+void ClipboardGuard::restoreLater(int delayMs)
+{
+    if (snapshot) {
+        restoreTimer->start(delayMs);
+    }
+}
+
+void ClipboardGuard::clearOurs()
+{
+    if (holdsOurs()) {
+        QGuiApplication::clipboard()->clear();
+    }
+    tag.clear();
+}
+
+bool ClipboardGuard::holdsOurs() const
+{
+    if (tag.isEmpty()) return false;
+
+    const QMimeData *current = QGuiApplication::clipboard()->mimeData();
+    return current && current->data(TagFormat) == tag;
+}
+
+QMimeData *ClipboardGuard::tagged(const QString &text)
+{
+    tag = QByteArray::number(QRandomGenerator::system()->generate64(), 16);
+
+    QMimeData *data = new QMimeData;
+    data->setText(text);
+    data->setData(TagFormat, tag);
+
+    // Ask clipboard managers and the Windows clipboard history to skip the text
+    data->setData("x-kde-passwordManagerHint", "secret");
+#ifdef Q_OS_WIN
+    data->setData("application/x-qt-windows-mime;value=\"ExcludeClipboardContentFromMonitorProcessing\"",
+                  QByteArray(4, '\0'));
+    data->setData("application/x-qt-windows-mime;value=\"CanIncludeInClipboardHistory\"",
+                  QByteArray(4, '\0'));
+#endif
+    return data;
+}
+
+void ClipboardGuard::restore()
+{
+    QMimeData *previous = snapshot;
+    snapshot = nullptr;
+    if (!previous) return;
+
+    // Whatever the user copied since stays
+    if (!holdsOurs()) {
+        delete previous;
+        return;
+    }
+
+    tag.clear();
+    if (previous->formats().isEmpty()) {
+        delete previous;
+        QGuiApplication::clipboard()->clear();
+    } else {
+        QGuiApplication::clipboard()->setMimeData(previous);
+    }
+}
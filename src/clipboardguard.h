@@ -0,0 +1,50 @@
+#ifndef CLIPBOARDGUARD_H
+#define CLIPBOARDGUARD_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+class QMimeData;
+class QTimer;
+
+// Puts snippet text on the clipboard and takes it off again. The text is
+// tagged, so it's only cleared or replaced while the clipboard still holds
+// it and never when the user has copied something else since. For pasting,
+// the previous contents are snapshotted in every format and put back once
+// the target has had time to read the text.
+class ClipboardGuard : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClipboardGuard(QObject *parent = nullptr);
+    ~ClipboardGuard();
+
+    // Places text for the user to paste. The clipboard keeps text, so it
+    // must own its data, not be a raw view of a secure buffer.
+    void copy(const QString &text);
+
+    // Places text to be pasted right away and keeps what was there before;
+    // text must own its data, as for copy()
+    void stash(const QString &text);
+
+    // Puts the stashed contents back after delayMs, if the clipboard still
+    // holds our text by then
+    void restoreLater(int delayMs);
+
+    // Clears the clipboard if it still holds our text
+    void clearOurs();
+
+    bool holdsOurs() const;
+
+private:
+    QMimeData *tagged(const QString &text);
+    void restore();
+
+    QByteArray tag;             // Random, identifies the text we placed last
+    QMimeData *snapshot;        // Contents from before stash()
+    QTimer *restoreTimer;
+};
+
+#endif // CLIPBOARDGUARD_H
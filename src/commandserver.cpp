@@ -0,0 +1,118 @@
+#include "commandserver.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+
+namespace {
+
+// Requests are a verb and an optional argument on one line
+const qint64 MaxRequestSize = 4096;
+const int ClientTimeoutMs = 2000;
+
+} // namespace
+
+CommandServer::CommandServer(const TypeHandler &typeHandler, QObject *parent)
+    : QObject(parent)
+    , typeHandler(typeHandler)
+    , server(new QLocalServer(this))
+{
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(server, &QLocalServer::newConnection, this, [this]() {
+        while (QLocalSocket *client = server->nextPendingConnection()) {
+            connect(client, &QLocalSocket::disconnected, client, &QObject::deleteLater);
+            connect(client, &QLocalSocket::readyRead, this, [this, client]() { readRequest(client); });
+            readRequest(client);
+        }
+    });
+}
+
+bool CommandServer::listen()
+{
+    const QString name = serverName();
+    if (server->listen(name)) {
+        return true;
+    }
+
+    // A socket file left behind by a crash; only reclaim it if nobody answers
+    if (server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(100)) {
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (server->listen(name)) {
+            return true;
+        }
+    }
+
+    qWarning("Failed to listen for commands on %s: %s", qPrintable(name), qPrintable(server->errorString()));
+    return false;
+}
+
+bool CommandServer::request(const QByteArray &command, const QString &argument, QString *error)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(ClientTimeoutMs)) {
+        return false;
+    }
+
+    QByteArray line = command;
+    if (!argument.isEmpty()) {
+        line += ' ' + argument.toUtf8();
+    }
+    line += '\n';
+    socket.write(line);
+    socket.flush();
+
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(ClientTimeoutMs)) {
+            *error = "No reply from KeyGhost";
+            return true;
+        }
+    }
+
+    QByteArray reply = socket.readLine().trimmed();
+    error->clear();
+    if (reply != "ok") {
+        *error = QString::fromUtf8(reply.startsWith("error ") ? reply.mid(6) : reply);
+    }
+    return true;
+}
+
+QString CommandServer::serverName()
+{
+    // Per user, so sessions of different users don't meet
+    QString user = qEnvironmentVariable("USER", qEnvironmentVariable("USERNAME"));
+    return "KeyGhost-" + user;
+}
+
+void CommandServer::readRequest(QLocalSocket *client)
+{
+    if (!client->canReadLine()) {
+        if (client->bytesAvailable() > MaxRequestSize) {
+            client->abort();
+        }
+        return;
+    }
+
+    QByteArray line = client->readLine().trimmed();
+    qsizetype space = line.indexOf(' ');
+    QByteArray verb = space < 0 ? line : line.left(space);
+    QString argument = space < 0 ? QString() : QString::fromUtf8(line.mid(space + 1));
+
+    QByteArray reply = "ok\n";
+    if (verb == "type" && !argument.isEmpty()) {
+        QString error = typeHandler(argument);
+        if (!error.isEmpty()) {
+            reply = "error " + error.toUtf8() + '\n';
+        }
+    } else if (verb == "show") {
+        emit showRequested();
+    } else {
+        reply = "error Unknown request\n";
+    }
+
+    client->write(reply);
+    client->disconnectFromServer();
+}
@@ -0,0 +1,49 @@
+#ifndef COMMANDSERVER_H
+#define COMMANDSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+class QLocalServer;
+class QLocalSocket;
+
+// Local socket the running instance listens on, so scripts and a second
+// launch can reach it without starting another GUI. One request per
+// connection, a single line each way:
+//
+//   type <name|id>\n    ->  ok\n | error <message>\n
+//   show\n              ->  ok\n
+//
+// The socket is only accessible to the user running KeyGhost.
+class CommandServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Returns an empty string once the snippet is on its way, otherwise why not
+    using TypeHandler = std::function<QString(const QString &target)>;
+
+    CommandServer(const TypeHandler &typeHandler, QObject *parent = nullptr);
+
+    // False if another instance already listens
+    bool listen();
+
+    // Client side: sends one request to the running instance and waits for
+    // its reply. Needs no widgets, only a QCoreApplication.
+    // Returns false if no instance is running.
+    static bool request(const QByteArray &command, const QString &argument, QString *error);
+
+signals:
+    void showRequested();
+
+private:
+    static QString serverName();
+    void readRequest(QLocalSocket *client);
+
+    TypeHandler typeHandler;
+    QLocalServer *server;
+};
+
+#endif // COMMANDSERVER_H
@@ -0,0 +1,204 @@
+#include "foregroundwatcher.h"
+#include <QGuiApplication>
+#include <QWindow>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+#ifdef KEYGHOST_HAVE_XCB
+#if QT_CONFIG(xcb)
+#define KEYGHOST_WATCH_X11
+#include <xcb/xcb.h>
+#include <cstdlib>
+#include <cstring>
+#endif
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+// WinEvent callbacks carry no user pointer; only one wait runs at a time
+ForegroundWatcher *hookOwner = nullptr;
+
+void CALLBACK foregroundProc(HWINEVENTHOOK, DWORD event, HWND window, LONG object, LONG, DWORD, DWORD)
+{
+    if (event == EVENT_SYSTEM_FOREGROUND && object == OBJID_WINDOW && window && hookOwner) {
+        QMetaObject::invokeMethod(hookOwner, "changed", Qt::QueuedConnection);
+    }
+}
+#endif
+
+#ifdef KEYGHOST_WATCH_X11
+xcb_connection_t *x11Connection()
+{
+    auto *x11 = qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
+    return x11 ? x11->connection() : nullptr;
+}
+#endif
+
+} // namespace
+
+ForegroundWatcher::ForegroundWatcher(QObject *parent)
+    : QObject(parent)
+    , watching(false)
+    , hook(nullptr)
+    , filtering(false)
+    , rootWindow(0)
+    , activeAtom(0)
+{
+}
+
+ForegroundWatcher::~ForegroundWatcher()
+{
+    stop();
+}
+
+void ForegroundWatcher::start()
+{
+    if (watching) return;
+    watching = true;
+
+#ifdef Q_OS_WIN
+    // Out of context and without our own windows, so the tray menu or this
+    // window coming to the front doesn't count
+    hookOwner = this;
+    hook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, foregroundProc,
+                           0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+    if (!hook) {
+        qWarning("Failed to watch the foreground window, error %lu", GetLastError());
+    }
+#else
+    if (!watchX11()) {
+        stateConnection = connect(qGuiApp, &QGuiApplication::applicationStateChanged,
+                                  this, &ForegroundWatcher::applicationStateChanged);
+    }
+#endif
+
+    // The target may already be in front, e.g. after picking from the tray
+    if (foreignWindowActive()) {
+        QMetaObject::invokeMethod(this, "changed", Qt::QueuedConnection);
+    }
+}
+
+void ForegroundWatcher::stop()
+{
+    watching = false;
+
+#ifdef Q_OS_WIN
+    if (hook) {
+        UnhookWinEvent(HWINEVENTHOOK(hook));
+        hook = nullptr;
+    }
+    if (hookOwner == this) {
+        hookOwner = nullptr;
+    }
+#endif
+
+    if (filtering) {
+        QCoreApplication::instance()->removeNativeEventFilter(this);
+        filtering = false;
+    }
+    if (stateConnection) {
+        disconnect(stateConnection);
+    }
+}
+
+void ForegroundWatcher::changed()
+{
+    // Events queued before stop() are stale
+    if (!watching) return;
+
+    stop();
+    emit activated();
+}
+
+bool ForegroundWatcher::watchX11()
+{
+#ifdef KEYGHOST_WATCH_X11
+    xcb_connection_t *connection = x11Connection();
+    if (!connection) return false;
+
+    rootWindow = xcb_setup_roots_iterator(xcb_get_setup(connection)).data->root;
+    if (activeAtom == 0) {
+        const char name[] = "_NET_ACTIVE_WINDOW";
+        xcb_intern_atom_reply_t *atom = xcb_intern_atom_reply(connection,
+            xcb_intern_atom(connection, 1, std::strlen(name), name), nullptr);
+        activeAtom = atom ? atom->atom : 0;
+        std::free(atom);
+        if (activeAtom == 0) return false;   // No EWMH window manager
+    }
+
+    // Keep whatever Qt already selects on the root window
+    xcb_get_window_attributes_reply_t *attributes = xcb_get_window_attributes_reply(connection,
+        xcb_get_window_attributes(connection, rootWindow), nullptr);
+    uint32_t mask = (attributes ? attributes->your_event_mask : 0) | XCB_EVENT_MASK_PROPERTY_CHANGE;
+    std::free(attributes);
+    xcb_change_window_attributes(connection, rootWindow, XCB_CW_EVENT_MASK, &mask);
+    xcb_flush(connection);
+
+    QCoreApplication::instance()->installNativeEventFilter(this);
+    filtering = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ForegroundWatcher::foreignWindowActive() const
+{
+#ifdef Q_OS_WIN
+    HWND window = GetForegroundWindow();
+    DWORD process = 0;
+    GetWindowThreadProcessId(window, &process);
+    return window && process != GetCurrentProcessId();
+#else
+#ifdef KEYGHOST_WATCH_X11
+    if (filtering) {
+        xcb_connection_t *connection = x11Connection();
+        xcb_get_property_reply_t *property = xcb_get_property_reply(connection,
+            xcb_get_property(connection, 0, rootWindow, activeAtom, XCB_ATOM_WINDOW, 0, 1), nullptr);
+        xcb_window_t active = 0;
+        if (property && xcb_get_property_value_length(property) >= int(sizeof(xcb_window_t))) {
+            active = *static_cast<xcb_window_t*>(xcb_get_property_value(property));
+        }
+        std::free(property);
+
+        if (active == 0) return false;
+        const QWindowList windows = QGuiApplication::allWindows();
+        for (QWindow *window : windows) {
+            if (window->winId() == active) return false;
+        }
+        return true;
+    }
+#endif
+    return QGuiApplication::applicationState() != Qt::ApplicationActive;
+#endif
+}
+
+bool ForegroundWatcher::nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result)
+{
+    Q_UNUSED(result);
+#ifdef KEYGHOST_WATCH_X11
+    if (filtering && eventType == "xcb_generic_event_t") {
+        auto *event = static_cast<xcb_generic_event_t*>(message);
+        if ((event->response_type & ~0x80) == XCB_PROPERTY_NOTIFY) {
+            auto *notify = reinterpret_cast<xcb_property_notify_event_t*>(event);
+            if (notify->window == rootWindow && notify->atom == activeAtom && foreignWindowActive()) {
+                QMetaObject::invokeMethod(this, "changed", Qt::QueuedConnection);
+            }
+        }
+    }
+#else
+    Q_UNUSED(eventType);
+    Q_UNUSED(message);
+#endif
+    return false;
+}
+
+void ForegroundWatcher::applicationStateChanged(Qt::ApplicationState state)
+{
+    if (state != Qt::ApplicationActive) {
+        changed();
+    }
+}
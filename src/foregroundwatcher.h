@@ -0,0 +1,47 @@
+#ifndef FOREGROUNDWATCHER_H
+#define FOREGROUNDWATCHER_H
+
+#include <QObject>
+#include <QAbstractNativeEventFilter>
+
+// Tells when the user has switched to another application's window, so a
+// snippet picked from the tray or the main window can be typed as soon as
+// its target is focused. Uses a foreground WinEvent hook on Windows and
+// _NET_ACTIVE_WINDOW on X11; elsewhere it goes by the application losing
+// the focus.
+class ForegroundWatcher : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+
+public:
+    explicit ForegroundWatcher(QObject *parent = nullptr);
+    ~ForegroundWatcher();
+
+    // Emits activated() once, for the next window of another application.
+    // If one is active already, activated() follows from the event loop.
+    void start();
+    void stop();
+    bool isWatching() const { return watching; }
+
+    bool nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result) override;
+
+signals:
+    void activated();
+
+private slots:
+    void changed();
+
+private:
+    bool foreignWindowActive() const;
+    bool watchX11();
+    void applicationStateChanged(Qt::ApplicationState state);
+
+    bool watching;
+    void *hook;             // HWINEVENTHOOK on Windows
+    bool filtering;         // X11 property events are being filtered
+    quint32 rootWindow;
+    quint32 activeAtom;     // _NET_ACTIVE_WINDOW
+    QMetaObject::Connection stateConnection;
+};
+
+#endif // FOREGROUNDWATCHER_H
@@ -0,0 +1,144 @@
+#include "hotkeyregistry.h"
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+HotkeyRegistry::HotkeyRegistry(WId window)
+    : window(window)
+    , nextSystemId(1)
+    , poolWarned(false)
+{
+}
+
+HotkeyRegistry::~HotkeyRegistry()
+{
+    unbindAll();
+}
+
+quint64 HotkeyRegistry::chord(int modifiers, int key)
+{
+    return (quint64(quint32(modifiers)) << 32) | quint32(key);
+}
+
+QList<HotkeyRegistry::Conflict> HotkeyRegistry::bindAll(const QList<Binding> &bindings)
+{
+    QList<Conflict> conflicts;
+
+    for (const Binding &binding : bindings) {
+        unbind(binding.id);
+    }
+
+    // Settle clashes in memory first so only winners reach the system
+    QList<Binding> winners;
+    winners.reserve(bindings.size());
+    QHash<quint64, int> claimed = owners;
+    claimed.reserve(owners.size() + bindings.size());
+    for (const Binding &binding : bindings) {
+        quint64 key = chord(binding.modifiers, binding.key);
+        auto it = claimed.constFind(key);
+        if (it != claimed.constEnd()) {
+            conflicts.append({ binding.id, binding.modifiers, binding.key, *it });
+            continue;
+        }
+        claimed.insert(key, binding.id);
+        winners.append(binding);
+    }
+
+    for (const Binding &binding : std::as_const(winners)) {
+        Conflict conflict;
+        if (!bind(binding.id, binding.modifiers, binding.key, &conflict)) {
+            conflicts.append(conflict);
+        }
+    }
+    return conflicts;
+}
+
+bool HotkeyRegistry::bind(int id, int modifiers, int key, Conflict *conflict)
+{
+    quint64 wanted = chord(modifiers, key);
+    if (chords.value(id, ~quint64(0)) == wanted) {
+        return true;
+    }
+    unbind(id);
+
+    int owner = owners.value(wanted, -1);
+    if (owner < 0 && registerWithSystem(id, modifiers, key)) {
+        owners.insert(wanted, id);
+        chords.insert(id, wanted);
+        return true;
+    }
+
+    if (conflict) {
+        *conflict = { id, modifiers, key, owner };
+    }
+    return false;
+}
+
+void HotkeyRegistry::unbind(int id)
+{
+    auto it = chords.find(id);
+    if (it == chords.end()) return;
+
+    unregisterWithSystem(id);
+    owners.remove(*it);
+    chords.erase(it);
+}
+
+void HotkeyRegistry::unbindAll()
+{
+    const QList<int> ids = chords.keys();
+    for (int id : ids) {
+        unregisterWithSystem(id);
+    }
+    owners.clear();
+    chords.clear();
+}
+
+int HotkeyRegistry::ownerOf(int modifiers, int key) const
+{
+    return owners.value(chord(modifiers, key), -1);
+}
+
+bool HotkeyRegistry::registerWithSystem(int id, int modifiers, int key)
+{
+    int systemId = 0;
+    if (!freeSystemIds.isEmpty()) {
+        systemId = freeSystemIds.takeLast();
+    } else if (nextSystemId <= MaxSystemId) {
+        systemId = nextSystemId++;
+    } else {
+        if (!poolWarned) {
+            qWarning("More than %d hotkeys; the rest stay unbound", MaxSystemId);
+            poolWarned = true;
+        }
+        return false;
+    }
+
+#ifdef Q_OS_WIN
+    if (!RegisterHotKey(reinterpret_cast<HWND>(window), systemId, UINT(modifiers), UINT(key))) {
+        freeSystemIds.append(systemId);
+        return false;
+    }
+#else
+    // Global hotkeys are only implemented for Windows so far; keep the
+    // in-memory index so conflicts are still reported
+    Q_UNUSED(modifiers);
+    Q_UNUSED(key);
+#endif
+    systemIds.insert(id, systemId);
+    idsBySystemId.insert(systemId, id);
+    return true;
+}
+
+void HotkeyRegistry::unregisterWithSystem(int id)
+{
+    const int systemId = systemIds.take(id);
+    if (systemId == 0) return;
+
+#ifdef Q_OS_WIN
+    UnregisterHotKey(reinterpret_cast<HWND>(window), systemId);
+#endif
+    idsBySystemId.remove(systemId);
+    freeSystemIds.append(systemId);
+}
@@ -0,0 +1,72 @@
+#ifndef HOTKEYREGISTRY_H
+#define HOTKEYREGISTRY_H
+
+#include <QHash>
+#include <QList>
+#include <QWidget>
+
+// Global hotkeys bound to one window. Every (modifiers, key) chord is indexed
+// in memory, so a clash between two of our own bindings is caught without a
+// system call, and chords are never altered behind the user's back.
+// Modifiers use the MOD_* values, keys the stored virtual key.
+//
+// Binding ids are the caller's own and may be any non-negative int. The
+// system only takes ids up to MaxSystemId, so each bound id is given one of
+// those from a pool that reuses released ids.
+class HotkeyRegistry
+{
+public:
+    static const int MaxSystemId = 0xBFFF;
+
+    struct Binding
+    {
+        int id;
+        int modifiers;
+        int key;
+    };
+
+    struct Conflict
+    {
+        int id;
+        int modifiers;
+        int key;
+        int ownerId;    // Binding that already holds the chord, -1 for another application
+    };
+
+    explicit HotkeyRegistry(WId window);
+    ~HotkeyRegistry();
+
+    HotkeyRegistry(const HotkeyRegistry &) = delete;
+    HotkeyRegistry &operator=(const HotkeyRegistry &) = delete;
+
+    // Binds a whole set at once. Clashes inside the set are resolved in
+    // list order before anything is handed to the system.
+    QList<Conflict> bindAll(const QList<Binding> &bindings);
+
+    // Rebinds id to the chord; on failure id is left unbound
+    bool bind(int id, int modifiers, int key, Conflict *conflict = nullptr);
+    void unbind(int id);
+    void unbindAll();
+
+    int ownerOf(int modifiers, int key) const;
+    bool isBound(int id) const { return chords.contains(id); }
+
+    // Binding behind an id from WM_HOTKEY, -1 if none
+    int idForSystemId(int systemId) const { return idsBySystemId.value(systemId, -1); }
+
+private:
+    static quint64 chord(int modifiers, int key);
+    bool registerWithSystem(int id, int modifiers, int key);
+    void unregisterWithSystem(int id);
+
+    WId window;
+    QHash<quint64, int> owners;     // chord -> id
+    QHash<int, quint64> chords;     // id -> chord
+    QHash<int, int> systemIds;      // id -> system id
+    QHash<int, int> idsBySystemId;  // system id -> id
+    QList<int> freeSystemIds;
+    int nextSystemId;
+    bool poolWarned;
+};
+
+#endif // HOTKEYREGISTRY_H
@@ -0,0 +1,71 @@
+#include "injectionbackend.h"
+#include <QList>
+
+#if defined(Q_OS_WIN)
+#include "wininputbackend.h"
+#elif defined(Q_OS_LINUX)
+#include "uinputbackend.h"
+#ifdef KEYGHOST_HAVE_XTEST
+#include "xtestbackend.h"
+#endif
+#endif
+
+bool InjectionBackend::sendText(const QString &text, const InjectionOptions &options,
+                                const InjectionProgress &progress)
+{
+    KeystrokePlan plan;
+    compile(text, layoutId(), plan);
+    return sendPlan(plan, options, progress);
+}
+
+InjectionBackend *InjectionBackend::create(const QString &preferred)
+{
+    QString wanted = qEnvironmentVariable("KEYGHOST_INJECTION", preferred).toLower();
+
+#if defined(Q_OS_WIN)
+    Q_UNUSED(wanted);
+    return new WinInputBackend();
+#elif defined(Q_OS_LINUX)
+    // Candidates in order of preference: XTest batches a whole snippet into one
+    // X round-trip, uinput works on Wayland and the console but needs device access
+    QList<InjectionBackend*> candidates;
+#ifdef KEYGHOST_HAVE_XTEST
+    candidates.append(new XTestBackend());
+#endif
+    candidates.append(new UinputBackend());
+
+    InjectionBackend *chosen = nullptr;
+    for (InjectionBackend *backend : candidates) {
+        if (backend->name() == wanted && backend->isAvailable()) {
+            chosen = backend;
+            break;
+        }
+    }
+    if (!chosen) {
+        if (!wanted.isEmpty()) {
+            qWarning("Injection backend '%s' is not available, falling back", qPrintable(wanted));
+        }
+        for (InjectionBackend *backend : candidates) {
+            if (backend->isAvailable()) {
+                chosen = backend;
+                break;
+            }
+        }
+    }
+
+    for (InjectionBackend *backend : candidates) {
+        if (backend != chosen) {
+            delete backend;
+        }
+    }
+
+    if (!chosen) {
+        qWarning("No keystroke injection backend is available");
+    }
+    return chosen;
+#else
+    Q_UNUSED(wanted);
+    qWarning("Keystroke injection is not supported on this platform");
+    return nullptr;
+#endif
+}
@@ -0,0 +1,114 @@
+#ifndef INJECTIONBACKEND_H
+#define INJECTIONBACKEND_H
+
+#include <QString>
+#include <functional>
+#include <vector>
+#include "pacer.h"
+#include "securememory.h"
+
+// How a backend paces the keystrokes of one send
+struct InjectionOptions
+{
+    int delayUs = 30000;    // Interval between characters in normal mode
+    bool burst = false;     // Submit the text in chunks instead of per character
+    int chunkSize = 64;     // Characters per chunk in burst mode, 0 for the whole text
+    int chunkDelayUs = 0;   // Interval between chunks in burst mode
+    int releaseWaitMs = 0;  // Longest wait for held modifier keys to come up before typing
+
+    // Characters handed to the OS per submission, 0 for the whole text.
+    // Normal mode without a delay has nothing to wait for and is sent in one go.
+    int charsPerSubmit() const
+    {
+        if (burst) return chunkSize;
+        return delayUs > 0 ? 1 : 0;
+    }
+
+    // Interval from one submission to the next
+    int pauseUs() const
+    {
+        return burst ? chunkDelayUs : delayUs;
+    }
+};
+
+// One character resolved against a keyboard layout
+struct KeyStroke
+{
+    enum Modifier : quint16 {
+        Shift   = 0x1,
+        Control = 0x2,
+        Alt     = 0x4
+    };
+
+    enum Flag : quint16 {
+        Unicode = 0x1   // No key produces the character, code holds the character itself
+    };
+
+    quint32 code = 0;       // Key in the backend's terms (VK, X keycode, evdev code)
+    quint16 modifiers = 0;
+    quint16 flags = 0;
+};
+
+// Text compiled into keystrokes for one layout. Plans are reusable as long as
+// the backend still reports the same layout id.
+struct KeystrokePlan
+{
+    quint64 layout = 0;
+    std::vector<KeyStroke, SecureAllocator<KeyStroke>> strokes;   // Spells out the text
+};
+
+// Called after each submission with the strokes typed so far, and again
+// during long pauses; returning false stops the send
+using InjectionProgress = std::function<bool(int typed, int total)>;
+
+// Platform layer that turns text into synthetic keystrokes for the focused window
+class InjectionBackend
+{
+public:
+    virtual ~InjectionBackend() = default;
+
+    // Short identifier used in settings and log messages
+    virtual QString name() const = 0;
+
+    // False if the backend can't be used in the current session
+    virtual bool isAvailable() const = 0;
+
+    // Identifies the keyboard layout keystrokes would be interpreted with right now
+    virtual quint64 layoutId() = 0;
+
+    // Resolves every character of text against the given layout
+    virtual void compile(const QString &text, quint64 layout, KeystrokePlan &plan) = 0;
+
+    // Keystroke of the Left arrow key, which moves the caret back one character
+    virtual KeyStroke caretLeft() = 0;
+
+    // Keystroke that pastes the clipboard, Ctrl+V
+    virtual KeyStroke pasteKey() = 0;
+
+    // True while Shift, Ctrl, Alt or the logo key is physically down, as it
+    // still is right after a hotkey. Backends that can't tell return false.
+    virtual bool modifiersHeld() { return false; }
+
+    // Types a compiled plan, batching and pausing as described by options.
+    // Blocks until done, so it is meant to run on the injection worker thread.
+    virtual bool sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                          const InjectionProgress &progress = InjectionProgress()) = 0;
+
+    // Compiles text for the current layout and types it
+    bool sendText(const QString &text, const InjectionOptions &options,
+                  const InjectionProgress &progress = InjectionProgress());
+
+    // Returns the best usable backend for this platform (caller takes ownership).
+    // The KEYGHOST_INJECTION environment variable or the preferred name
+    // ("sendinput", "xtest" or "uinput") overrides the automatic choice.
+    static InjectionBackend *create(const QString &preferred = QString());
+
+    // Timing of the pauses in the last sendPlan
+    PacingStats pacing() const { return pacer.stats(); }
+
+protected:
+    // Backends call begin() before the first submission and wait() between them
+    Pacer pacer;
+};
+
+#endif // INJECTIONBACKEND_H
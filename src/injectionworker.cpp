@@ -0,0 +1,138 @@
+#include "injectionworker.h"
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace {
+
+// Minimum time between progress signals, so per-character sends don't flood the GUI thread
+const qint64 ProgressIntervalMs = 50;
+
+} // namespace
+
+InjectionWorker::InjectionWorker(InjectionBackend *backend, QObject *parent)
+    : QObject(parent)
+    , backend(backend)
+    , cancelledJob(0)
+{
+}
+
+InjectionWorker::~InjectionWorker()
+{
+    delete backend;
+}
+
+void InjectionWorker::cancel(int job)
+{
+    cancelledJob.store(job);
+}
+
+void InjectionWorker::typeText(int job, const SecretText &text, const InjectionOptions &options,
+                               int snippetId, int caretBack)
+{
+    if (!backend || !text) {
+        emit finished(job, false);
+        return;
+    }
+
+    // Reuse the snippet's plan if it was compiled for this text and layout
+    quint64 layout = backend->layoutId();
+    KeystrokePlan uncached;
+    KeystrokePlan *plan = &uncached;
+    if (snippetId >= 0) {
+        CachedPlan &cached = planCache[snippetId];
+        bool sameText = cached.source && (cached.source == text || *cached.source == *text);
+        if (cached.plan.layout != layout || !sameText) {
+            cached.source = text;
+            backend->compile(text->rawText(), layout, cached.plan);
+        }
+        plan = &cached.plan;
+    } else {
+        backend->compile(text->rawText(), layout, uncached);
+    }
+
+    // Caret moves go on a copy so the cached plan only ever holds the text
+    if (caretBack > 0) {
+        if (plan != &uncached) {
+            uncached = *plan;
+            plan = &uncached;
+        }
+        uncached.strokes.insert(uncached.strokes.end(), size_t(caretBack), backend->caretLeft());
+    }
+
+    waitForModifiers(job, options);
+    send(job, *plan, options);
+}
+
+void InjectionWorker::pasteClipboard(int job, const InjectionOptions &options, int caretBack)
+{
+    if (!backend) {
+        emit finished(job, false);
+        return;
+    }
+
+    KeystrokePlan plan;
+    plan.layout = backend->layoutId();
+    plan.strokes.push_back(backend->pasteKey());
+    plan.strokes.insert(plan.strokes.end(), size_t(qMax(caretBack, 0)), backend->caretLeft());
+
+    waitForModifiers(job, options);
+    send(job, plan, options);
+}
+
+void InjectionWorker::waitForModifiers(int job, const InjectionOptions &options)
+{
+    // Right after a hotkey its modifiers are usually still down and would
+    // turn the typed letters into shortcuts
+    if (options.releaseWaitMs > 0) {
+        QElapsedTimer waited;
+        waited.start();
+        while (backend->modifiersHeld() && waited.elapsed() < options.releaseWaitMs
+               && cancelledJob.load() != job) {
+            QThread::msleep(5);
+        }
+    }
+}
+
+void InjectionWorker::send(int job, const KeystrokePlan &plan, const InjectionOptions &options)
+{
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    int typedCount = 0;
+    const qint64 startedNs = Pacer::nowNs();
+
+    bool completed = backend->sendPlan(plan, options, [&](int typed, int total) {
+        typedCount = typed;
+        if (cancelledJob.load() == job) {
+            return false;
+        }
+        if (typed == total || sinceProgress.elapsed() >= ProgressIntervalMs) {
+            emit progress(job, typed, total);
+            sinceProgress.restart();
+        }
+        return true;
+    });
+
+    if (!completed && cancelledJob.load() != job) {
+        qWarning("Injection backend '%s' failed to type the text", qPrintable(backend->name()));
+    }
+
+    PacingStats stats = backend->pacing();
+    const qint64 elapsedNs = Pacer::nowNs() - startedNs;
+    if (stats.waits > 0 && elapsedNs > 0) {
+        emit paced(job, typedCount * 1e9 / double(elapsedNs), stats.jitterUs, stats.maxLateUs);
+    }
+
+    emit finished(job, completed);
+}
+
+void InjectionWorker::forgetPlan(int snippetId)
+{
+    // Plans and their texts live in secure memory and are wiped as they're released
+    for (auto it = planCache.begin(); it != planCache.end();) {
+        if (snippetId < 0 || it.key() == snippetId) {
+            it = planCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
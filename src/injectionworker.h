@@ -0,0 +1,60 @@
+#ifndef INJECTIONWORKER_H
+#define INJECTIONWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <atomic>
+#include "injectionbackend.h"
+
+// Runs the typing loop on its own thread so the window, the tray menu and
+// hotkey handling stay responsive while a long snippet is being typed
+class InjectionWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Takes ownership of the backend
+    explicit InjectionWorker(InjectionBackend *backend, QObject *parent = nullptr);
+    ~InjectionWorker();
+
+    // Thread-safe: stops the given job after its current chunk
+    void cancel(int job);
+
+public slots:
+    // Types text, then presses Left caretBack times. Texts sent with a snippet
+    // id keep their compiled plan, which is reused until the text or the
+    // keyboard layout changes. The text is compiled where it is, not copied.
+    void typeText(int job, const SecretText &text, const InjectionOptions &options,
+                  int snippetId = -1, int caretBack = 0);
+
+    // Presses the paste key, then Left caretBack times. The text must already
+    // be on the clipboard.
+    void pasteClipboard(int job, const InjectionOptions &options, int caretBack = 0);
+
+    // Drops the cached plan of a snippet, or of all snippets for -1
+    void forgetPlan(int snippetId);
+
+signals:
+    void progress(int job, int typed, int total);
+    void finished(int job, bool completed);
+
+    // Sent before finished() for texts typed with pauses: characters per
+    // second achieved and how far the pauses strayed from their deadlines
+    void paced(int job, double charsPerSecond, double jitterUs, double maxLateUs);
+
+private:
+    struct CachedPlan {
+        SecretText source;
+        KeystrokePlan plan;
+    };
+
+    void waitForModifiers(int job, const InjectionOptions &options);
+    void send(int job, const KeystrokePlan &plan, const InjectionOptions &options);
+
+    InjectionBackend *backend;
+    std::atomic<int> cancelledJob;
+    QHash<int, CachedPlan> planCache;
+};
+
+#endif // INJECTIONWORKER_H
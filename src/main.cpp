@@ -1,18 +1,65 @@
 #include "mainwindow.h"
+#include "commandserver.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QDir>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+// keyghost --type <name|id>: asks the running instance to type a snippet.
+// Builds no widgets, so it's cheap enough to call from scripts and launchers.
+static int runClient(int argc, char *argv[], const char *target)
+{
+#ifdef Q_OS_WIN
+    // A GUI subsystem executable has no console of its own
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+    if (!target) {
+        fprintf(stderr, "Usage: keyghost --type <name|id>\n");
+        return 2;
+    }
+    
+    QCoreApplication app(argc, argv);
+    QString error;
+    if (!CommandServer::request("type", QString::fromLocal8Bit(target), &error)) {
+        fprintf(stderr, "KeyGhost is not running.\n");
+        return 3;
+    }
+    if (!error.isEmpty()) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--type") == 0) {
+            return runClient(argc, argv, i + 1 < argc ? argv[i + 1] : nullptr);
+        }
+    }
+    
     QApplication app(argc, argv);
     
     // Set application information for QSettings
     QCoreApplication::setOrganizationName("mxrcode");
     QCoreApplication::setApplicationName("KeyGhost");
     
+    // A second launch brings the running instance to the front instead
+    QString error;
+    if (CommandServer::request("show", QString(), &error)) {
+        return 0;
+    }
+    
     try {
         // Create application data directory if it doesn't exist
         QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
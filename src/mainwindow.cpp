@@ -1,6 +1,21 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "settingsdialog.h"
+#include "appconfig.h"
+#include "injectionworker.h"
+#include "vaultcrypto.h"
+#include "snippetwriter.h"
+#include "vaultfile.h"
+#include "snippetlistmodel.h"
+#include "snippettraymenu.h"
+#include "trigramindex.h"
+#include "quickpalette.h"
+#include "hotkeyregistry.h"
+#include "chorddispatcher.h"
+#include "foregroundwatcher.h"
+#include "clipboardguard.h"
+#include "commandserver.h"
+#include "snippettransfer.h"
 #include <QMessageBox>
 #include <QCloseEvent>
 #include <QAction>
@@ -9,8 +24,6 @@
 #include <QHBoxLayout>
 #include <QStyle>
 #include <QInputDialog>
-#include <QClipboard>
-#include <QCryptographicHash>
 #include <QGroupBox>
 #include <QShortcut>
 #include <QKeySequenceEdit>
@@ -19,23 +32,201 @@
 #include <QTimer>
 #include <QThread>
 #include <QDateTime>
+#include <QStatusBar>
+#include <QFileDialog>
+#include <QProgressDialog>
+#include <QtConcurrentRun>
+#include <limits>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+// Hotkeys are stored with the Win32 MOD_* values so vaults stay portable
+#define MOD_ALT     0x0001
+#define MOD_CONTROL 0x0002
+#define MOD_SHIFT   0x0004
+#define MOD_WIN     0x0008
+#endif
+
+namespace {
+
+// Binding id of the quick palette, at the top of the int range so it stays
+// clear of snippet ids; the registry maps it to a system hotkey id
+const int PaletteHotkeyId = std::numeric_limits<int>::max();
+
+// Leaders of hotkey sequences, one id per ChordDispatcher leader slot
+const int LeaderHotkeyIdBase = PaletteHotkeyId - ChordDispatcher::MaxLeaders;
+
+// Snippet ids stay below the ids above
+const int MaxSnippetId = LeaderHotkeyIdBase - 1;
+
+// Time the target gets to read a pasted text before the clipboard is restored
+const int PasteRestoreDelayMs = 500;
+
+bool isLeaderHotkeyId(int id)
+{
+    return id >= LeaderHotkeyIdBase && id < LeaderHotkeyIdBase + ChordDispatcher::MaxLeaders;
+}
+
+// Qt modifiers to the stored MOD_* flags
+int hotkeyModifiers(Qt::KeyboardModifiers modifiers)
+{
+    int mod = 0;
+    if (modifiers & Qt::AltModifier)     mod |= MOD_ALT;
+    if (modifiers & Qt::ControlModifier) mod |= MOD_CONTROL;
+    if (modifiers & Qt::ShiftModifier)   mod |= MOD_SHIFT;
+    if (modifiers & Qt::MetaModifier)    mod |= MOD_WIN;
+    return mod;
+}
+
+Qt::KeyboardModifiers qtModifiers(int modifiers)
+{
+    Qt::KeyboardModifiers qtMods = Qt::NoModifier;
+    if (modifiers & MOD_ALT) qtMods |= Qt::AltModifier;
+    if (modifiers & MOD_CONTROL) qtMods |= Qt::ControlModifier;
+    if (modifiers & MOD_SHIFT) qtMods |= Qt::ShiftModifier;
+    if (modifiers & MOD_WIN) qtMods |= Qt::MetaModifier;
+    return qtMods;
+}
+
+// Keys after the first one, up to the three QKeySequence can hold
+QKeySequence sequenceTail(const QKeySequence &keySeq)
+{
+    QKeyCombination none = QKeyCombination::fromCombined(0);
+    return QKeySequence(keySeq.count() > 1 ? keySeq[1] : none,
+                        keySeq.count() > 2 ? keySeq[2] : none,
+                        keySeq.count() > 3 ? keySeq[3] : none);
+}
+
+// Sealing for the vault at path: the data key from its header, unwrapped
+// with the master key, or the master key itself for older vaults
+VaultCrypto *openVaultCrypto(const QString &path)
+{
+    QByteArray masterKey = VaultCrypto::defaultKey();
+    QByteArray wrapped = VaultFile::readWrappedKey(path);
+    if (wrapped.isEmpty()) {
+        return new VaultCrypto(masterKey);
+    }
+    
+    QByteArray dataKey;
+    VaultCrypto *crypto = nullptr;
+    if (VaultCrypto(masterKey).unwrapKey(wrapped, dataKey)) {
+        crypto = new VaultCrypto(dataKey);
+    } else {
+        qWarning("Failed to unwrap the vault key; snippet texts can't be decrypted");
+        crypto = new VaultCrypto(masterKey);
+    }
+    SecureArena::wipe(dataKey.data(), std::size_t(dataKey.size()));
+    SecureArena::wipe(masterKey.data(), std::size_t(masterKey.size()));
+    return crypto;
+}
+
+// A snippet's whole hotkey, sequence tail included; empty if it has none
+QKeySequence snippetSequence(const TextSnippet *snippet)
+{
+    if (snippet->hotkeyKey == 0) return QKeySequence();
+    
+    QKeyCombination none = QKeyCombination::fromCombined(0);
+    const QKeySequence &tail = snippet->hotkeyTail;
+    return QKeySequence(
+        QKeyCombination(qtModifiers(snippet->hotkeyModifiers), Qt::Key(snippet->hotkeyKey)),
+        tail.count() > 0 ? tail[0] : none,
+        tail.count() > 1 ? tail[1] : none,
+        tail.count() > 2 ? tail[2] : none);
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , trayIcon(nullptr)
+    , hotkeys(nullptr)
+    , chords(nullptr)
+    , searchIndex(new TrigramIndex)
+    , quickPalette(nullptr)
+    , injectionThread(nullptr)
+    , injectionWorker(nullptr)
+    , stopTypingAction(nullptr)
+    , typingJob(0)
+    , lastTypingJob(0)
+    , typingSnippetId(-1)
+    , pasteJob(0)
+    , targetSnippetId(-1)
+    , vaultCrypto(openVaultCrypto(VaultFile::defaultPath()))
+    , vault(new VaultFile(VaultFile::defaultPath()))
+    , writeGeneration(0)
+    , writtenGeneration(0)
+    , vaultLoading(false)
+    , listingNs(0)
+    , transferProgress(nullptr)
+    , transferKind(ImportTransfer)
+    , transferCount(0)
+    , rotatingKey(false)
+    , pendingCrypto(nullptr)
+    , selectedSnippetId(-1)
     , nextHotkeyId(1)
-    , maskText(false)
-    , typingDelay(30)
-    , autoClear(false)
     , settingsDialog(nullptr)
 {
+    startupTimer.start();
+    config = new AppConfig(this);
     ui->setupUi(this);
     
     // Initialize clipboard timer before other operations
     clipboardTimer = new QTimer(this);
     clipboardTimer->setSingleShot(true);
     connect(clipboardTimer, &QTimer::timeout, this, &MainWindow::clearClipboardDelayed);
+    clipboardGuard = new ClipboardGuard(this);
+    
+    // Typing runs on a dedicated worker thread with the platform's injection backend
+    InjectionBackend *backend = InjectionBackend::create(config->values().injectionBackend);
+    if (backend) {
+        injectionThread = new QThread(this);
+        injectionWorker = new InjectionWorker(backend);
+        injectionWorker->moveToThread(injectionThread);
+        connect(injectionThread, &QThread::finished, injectionWorker, &QObject::deleteLater);
+        connect(injectionWorker, &InjectionWorker::progress, this, &MainWindow::typingProgress);
+        connect(injectionWorker, &InjectionWorker::finished, this, &MainWindow::typingFinished);
+        connect(injectionWorker, &InjectionWorker::paced, this, &MainWindow::typingPaced);
+        injectionThread->start();
+    }
+    
+    // Snippet changes are coalesced for a short moment and written on a background thread
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(250);
+    connect(saveTimer, &QTimer::timeout, this, [this]() { flushSnippets(false); });
+    
+    writerThread = new QThread(this);
+    snippetWriter = new SnippetWriter(vault, vaultCrypto);
+    snippetWriter->moveToThread(writerThread);
+    connect(writerThread, &QThread::finished, snippetWriter, &QObject::deleteLater);
+    connect(snippetWriter, &SnippetWriter::written, this, &MainWindow::snippetsWritten);
+    connect(snippetWriter, &SnippetWriter::recordsLoaded, this, &MainWindow::snippetsLoaded);
+    connect(snippetWriter, &SnippetWriter::loadFinished, this, &MainWindow::vaultLoaded);
+    writerThread->start();
+    
+    // Snippets picked from the tray or the window wait for the target window to come to the front
+    foregroundWatcher = new ForegroundWatcher(this);
+    connect(foregroundWatcher, &ForegroundWatcher::activated, this, &MainWindow::targetWindowActivated);
+    targetTimeout = new QTimer(this);
+    targetTimeout->setSingleShot(true);
+    targetTimeout->setInterval(30000);
+    connect(targetTimeout, &QTimer::timeout, this, [this]() {
+        cancelTargetWait("No target window was selected.");
+    });
+    
+    transferWatcher = new QFutureWatcher<TransferResult>(this);
+    connect(transferWatcher, &QFutureWatcherBase::progressValueChanged, this, [this](int value) {
+        if (transferProgress) {
+            transferProgress->setValue(value);
+        }
+    });
+    connect(transferWatcher, &QFutureWatcherBase::finished, this, &MainWindow::transferFinished);
+    
+    forgetTextTimer = new QTimer(this);
+    forgetTextTimer->setInterval(1000);
+    connect(forgetTextTimer, &QTimer::timeout, this, &MainWindow::forgetIdleTexts);
     
     // Set the window icon
     setWindowIcon(QApplication::style()->standardIcon(QStyle::SP_ComputerIcon));
@@ -46,19 +237,82 @@ MainWindow::MainWindow(QWidget *parent)
     // Create actions
     createActions();
     
-    // Load saved snippets - do this before setting up tray icon
-    loadSnippets();
+    // Hotkeys are indexed by chord so clashes show up before any system call
+    hotkeys = new HotkeyRegistry(winId());
+    
+    // Sequences such as "Alt+K, P" share one global hotkey for their first chord
+    chords = new ChordDispatcher(this);
+    chords->setTimeout(config->values().sequenceTimeout);
+    connect(chords, &ChordDispatcher::matched, this, &MainWindow::fireSnippet);
+    connect(chords, &ChordDispatcher::pendingChanged, this, [this](bool pending) {
+        if (pending) {
+            statusBar()->showMessage("Waiting for the rest of the hotkey sequence...");
+        } else {
+            statusBar()->clearMessage();
+        }
+    });
+    
+    // Search palette over names and tags, opened by a global hotkey
+    quickPalette = new QuickPalette(searchIndex, snippetModel);
+    connect(quickPalette, &QuickPalette::snippetChosen, this, &MainWindow::sendKeystroke);
+    HotkeyRegistry::Conflict conflict;
+    if (!registerPaletteHotKey(&conflict)) {
+        reportHotkeyConflicts({ conflict });
+    }
     
     // Setup the system tray icon
     createTrayIcon();
     
+    connect(config, &AppConfig::changed, this, &MainWindow::settingsChanged);
+    
+    // Scripts fire snippets through the running instance; a second launch just shows this window
+    commandServer = new CommandServer([this](const QString &target) { return typeRequested(target); }, this);
+    connect(commandServer, &CommandServer::showRequested, this, [this]() {
+        show();
+        raise();
+        activateWindow();
+    });
+    commandServer->listen();
+    
     setWindowTitle("KeyGhost");
     resize(500, 400);
+    qInfo("Startup: window built in %.1f ms", startupTimer.nsecsElapsed() / 1e6);
+    
+    // The vault is read on the writer thread while the window paints; snippets arrive in batches
+    loadSnippets();
+    QTimer::singleShot(0, this, [this]() {
+        qInfo("Startup: event loop running after %.1f ms", startupTimer.nsecsElapsed() / 1e6);
+    });
 }
 
 MainWindow::~MainWindow()
 {
     unregisterAllHotKeys();
+    delete hotkeys;
+    delete quickPalette;
+    
+    // An import, export or key rotation still uses the vault and its keys
+    transferWatcher->cancel();
+    transferWatcher->waitForFinished();
+    
+    // Write out pending changes before the writer goes away
+    flushSnippets(true);
+    writerThread->quit();
+    writerThread->wait();
+    
+    // Stop a running send and wait for the worker to wind down
+    if (injectionThread) {
+        if (typingJob != 0) {
+            injectionWorker->cancel(typingJob);
+        }
+        injectionThread->quit();
+        injectionThread->wait();
+    }
+    
+    delete searchIndex;
+    delete vault;
+    delete vaultCrypto;
+    delete pendingCrypto;
     delete ui;
 }
 
@@ -72,7 +326,13 @@ void MainWindow::setupUi()
     QGroupBox *snippetsGroup = new QGroupBox("Text Snippets", this);
     QVBoxLayout *snippetsLayout = new QVBoxLayout(snippetsGroup);
     
-    snippetList = new QListWidget(this);
+    // Model/view list: rows are formatted only when they become visible
+    snippetModel = new SnippetListModel(this);
+    snippetList = new QListView(this);
+    snippetList->setModel(snippetModel);
+    snippetList->setUniformItemSizes(true);
+    snippetList->setSelectionMode(QAbstractItemView::SingleSelection);
+    snippetList->setEditTriggers(QAbstractItemView::NoEditTriggers);
     snippetsLayout->addWidget(snippetList);
     
     // Buttons for list management
@@ -80,9 +340,13 @@ void MainWindow::setupUi()
     QPushButton *addButton = new QPushButton("Add New", this);
     QPushButton *editButton = new QPushButton("Edit", this);
     QPushButton *deleteButton = new QPushButton("Delete", this);
+    QPushButton *importButton = new QPushButton("Import...", this);
+    QPushButton *exportButton = new QPushButton("Export...", this);
     listButtonLayout->addWidget(addButton);
     listButtonLayout->addWidget(editButton);
     listButtonLayout->addWidget(deleteButton);
+    listButtonLayout->addWidget(importButton);
+    listButtonLayout->addWidget(exportButton);
     snippetsLayout->addLayout(listButtonLayout);
     
     mainLayout->addWidget(snippetsGroup);
@@ -105,6 +369,15 @@ void MainWindow::setupUi()
     detailsLayout->addWidget(textLabel);
     detailsLayout->addWidget(textInput);
     
+    // Tags input, searched by the quick palette
+    QHBoxLayout *tagsLayout = new QHBoxLayout();
+    QLabel *tagsLabel = new QLabel("Tags:", this);
+    tagsInput = new QLineEdit(this);
+    tagsInput->setPlaceholderText("Comma-separated");
+    tagsLayout->addWidget(tagsLabel);
+    tagsLayout->addWidget(tagsInput);
+    detailsLayout->addLayout(tagsLayout);
+    
     // Action buttons
     QHBoxLayout *actionButtonLayout = new QHBoxLayout();
     QPushButton *saveButton = new QPushButton("Save Snippet", this);
@@ -116,8 +389,12 @@ void MainWindow::setupUi()
     detailsLayout->addLayout(actionButtonLayout);
     
     // Add reset button
+    QHBoxLayout *maintenanceLayout = new QHBoxLayout();
+    QPushButton *rotateKeyButton = new QPushButton("Rotate Encryption Key", this);
     QPushButton *resetButton = new QPushButton("Reset All Settings", this);
-    detailsLayout->addWidget(resetButton);
+    maintenanceLayout->addWidget(rotateKeyButton);
+    maintenanceLayout->addWidget(resetButton);
+    detailsLayout->addLayout(maintenanceLayout);
     
     mainLayout->addWidget(detailsGroup);
     
@@ -125,13 +402,26 @@ void MainWindow::setupUi()
     connect(addButton, &QPushButton::clicked, this, &MainWindow::addNewSnippet);
     connect(editButton, &QPushButton::clicked, this, &MainWindow::editSelectedSnippet);
     connect(deleteButton, &QPushButton::clicked, this, &MainWindow::deleteSelectedSnippet);
+    connect(importButton, &QPushButton::clicked, this, &MainWindow::importSnippets);
+    connect(exportButton, &QPushButton::clicked, this, &MainWindow::exportSnippets);
     connect(saveButton, &QPushButton::clicked, this, &MainWindow::saveSnippets);
     connect(testButton, &QPushButton::clicked, [this]() { sendKeystroke(-1); });
     connect(settingsButton, &QPushButton::clicked, this, &MainWindow::openSettings);
+    connect(rotateKeyButton, &QPushButton::clicked, this, &MainWindow::rotateKey);
     connect(resetButton, &QPushButton::clicked, this, &MainWindow::resetAllSettings);
-    connect(snippetList, &QListWidget::currentRowChanged, this, &MainWindow::snippetSelected);
+    connect(snippetList->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+            [this](const QModelIndex &current) { snippetSelected(current.row()); });
     
     setCentralWidget(centralWidget);
+    
+    // Typing progress, shown in the status bar while the worker is busy
+    typingStatusLabel = new QLabel(this);
+    stopTypingButton = new QPushButton("Stop", this);
+    statusBar()->addPermanentWidget(typingStatusLabel);
+    statusBar()->addPermanentWidget(stopTypingButton);
+    typingStatusLabel->hide();
+    stopTypingButton->hide();
+    connect(stopTypingButton, &QPushButton::clicked, this, &MainWindow::stopTyping);
 }
 
 void MainWindow::createActions()
@@ -143,234 +433,721 @@ void MainWindow::createActions()
     QShortcut *saveShortcut = new QShortcut(QKeySequence("Ctrl+S"), this);
     connect(saveShortcut, &QShortcut::activated, this, &MainWindow::saveSnippets);
     
+    QShortcut *paletteShortcut = new QShortcut(QKeySequence("Ctrl+K"), this);
+    connect(paletteShortcut, &QShortcut::activated, this, &MainWindow::showQuickPalette);
+    
     QShortcut *deleteShortcut = new QShortcut(QKeySequence("Delete"), this);
     connect(deleteShortcut, &QShortcut::activated, this, &MainWindow::deleteSelectedSnippet);
 }
 
-void MainWindow::registerHotKey(TextSnippet *snippet)
+bool MainWindow::registerHotKey(TextSnippet *snippet, HotkeyRegistry::Conflict *conflict)
 {
-    if (!snippet) return;
+    if (!snippet) return false;
+    
+    // Snippets without a hotkey are only typed from the list, tray, palette or command line
+    if (snippet->hotkeyKey == 0) {
+        snippet->hotkeyActive = false;
+        return true;
+    }
     
     // Validate hotkey parameters
-    if (snippet->hotkeyKey == 0 || snippet->hotkeyId <= 0) {
+    if (snippet->hotkeyId <= 0) {
         qWarning("Invalid hotkey parameters for snippet: %s", qPrintable(snippet->name));
-        return;
+        return false;
     }
     
-    // Try to register the hotkey, retry with a different combination if it fails
-    int attempts = 0;
-    bool success = false;
+    // The user's chord is kept as is; a clash leaves the snippet without an active hotkey
+    if (snippet->hotkeyTail.isEmpty()) {
+        snippet->hotkeyActive = hotkeys->bind(snippet->hotkeyId, snippet->hotkeyModifiers,
+                                              snippet->hotkeyKey, conflict);
+        return snippet->hotkeyActive;
+    }
+    
+    // A sequence only needs its leader registered, and only once for all sequences sharing it
+    snippet->hotkeyActive = false;
+    QList<ChordDispatcher::Chord> sequence = { { snippet->hotkeyModifiers, snippet->hotkeyKey } };
+    for (int i = 0; i < snippet->hotkeyTail.count(); i++) {
+        QKeyCombination combination = snippet->hotkeyTail[i];
+        sequence.append({ hotkeyModifiers(combination.keyboardModifiers()), int(combination.key()) });
+    }
     
-    while (!success && attempts < 5) {
-        if (RegisterHotKey((HWND)winId(), snippet->hotkeyId, 
-                        snippet->hotkeyModifiers, snippet->hotkeyKey)) {
-            success = true;
+    int owner = hotkeys->ownerOf(snippet->hotkeyModifiers, snippet->hotkeyKey);
+    if (owner < 0 || isLeaderHotkeyId(owner)) {
+        owner = chords->insert(snippet->hotkeyId, sequence);
+        if (owner == ChordDispatcher::NoLeaderSlot) {
+            qWarning("Too many different hotkey sequence leaders");
+        }
+    }
+    if (owner != -1) {
+        if (conflict) {
+            *conflict = { snippet->hotkeyId, snippet->hotkeyModifiers, snippet->hotkeyKey,
+                          owner == ChordDispatcher::NoLeaderSlot ? -1 : owner };
+        }
+        return false;
+    }
+    
+    int leaderId = LeaderHotkeyIdBase + chords->leaderIndex(snippet->hotkeyModifiers, snippet->hotkeyKey);
+    if (!hotkeys->isBound(leaderId)
+        && !hotkeys->bind(leaderId, snippet->hotkeyModifiers, snippet->hotkeyKey, conflict)) {
+        chords->remove(snippet->hotkeyId);
+        if (conflict) {
+            conflict->id = snippet->hotkeyId;
+        }
+        return false;
+    }
+    snippet->hotkeyActive = true;
+    return true;
+}
+
+void MainWindow::unregisterHotKey(TextSnippet *snippet)
+{
+    hotkeys->unbind(snippet->hotkeyId);
+    
+    // The leader goes once no sequence starts with it
+    int leader = chords->remove(snippet->hotkeyId);
+    if (leader >= 0) {
+        hotkeys->unbind(LeaderHotkeyIdBase + leader);
+    }
+    snippet->hotkeyActive = false;
+}
+
+bool MainWindow::registerPaletteHotKey(HotkeyRegistry::Conflict *conflict)
+{
+    hotkeys->unbind(PaletteHotkeyId);
+    
+    QKeySequence keySeq(config->values().paletteHotkey);
+    if (keySeq.isEmpty()) return true;
+    
+    // Same Qt key to VK mapping as snippet hotkeys
+    QKeyCombination combination = keySeq[0];
+    int mod = hotkeyModifiers(combination.keyboardModifiers());
+    
+    return hotkeys->bind(PaletteHotkeyId, mod, combination.key(), conflict);
+}
+
+void MainWindow::reportHotkeyConflicts(const QList<HotkeyRegistry::Conflict> &conflicts)
+{
+    if (conflicts.isEmpty()) return;
+    
+    auto describe = [this](int id) {
+        if (id == PaletteHotkeyId) return QString("Quick Launch");
+        if (isLeaderHotkeyId(id)) return QString("a hotkey sequence");
+        TextSnippet *snippet = snippets.value(id);
+        return snippet ? QString("\"%1\"").arg(snippet->name) : QString("Snippet %1").arg(id);
+    };
+    
+    // Keep the dialog readable for large vaults
+    const int maxLines = 10;
+    QStringList lines;
+    for (const HotkeyRegistry::Conflict &conflict : conflicts) {
+        if (lines.size() == maxLines) {
+            lines.append(QString("...and %1 more.").arg(conflicts.size() - maxLines));
+            break;
+        }
+        QString hotkey = hotkeyToString(conflict.modifiers, conflict.key);
+        if (conflict.ownerId >= 0) {
+            lines.append(QString("%1: %2 is already used by %3")
+                .arg(describe(conflict.id), hotkey, describe(conflict.ownerId)));
         } else {
-            // If failed, try a different key combination
-            attempts++;
-            
-            if (attempts >= 5) {
-                qWarning("Failed to register hotkey for snippet: %s", qPrintable(snippet->name));
-                return;
-            }
-            
-            // Try different modifier combinations
-            if (snippet->hotkeyModifiers == MOD_ALT) {
-                snippet->hotkeyModifiers = MOD_CONTROL;
-            } else if (snippet->hotkeyModifiers == MOD_CONTROL) {
-                snippet->hotkeyModifiers = MOD_CONTROL | MOD_ALT;
-            } else {
-                // Increment the key if we've tried all modifier combinations
-                snippet->hotkeyKey++;
-            }
+            lines.append(QString("%1: %2 is taken by another application")
+                .arg(describe(conflict.id), hotkey));
+        }
+    }
+    
+    QMessageBox::warning(this, "Hotkey Conflicts",
+        "These hotkeys could not be registered and stay inactive until changed:\n\n" + lines.join("\n"));
+}
+
+void MainWindow::showQuickPalette()
+{
+    quickPalette->popup();
+}
+
+void MainWindow::importSnippets()
+{
+    if (vaultLoading || transferWatcher->isRunning()) {
+        statusBar()->showMessage("Still loading snippets, try again in a moment.", 3000);
+        return;
+    }
+    
+    QString path = QFileDialog::getOpenFileName(this, "Import Snippets", QString(), SnippetTransfer::fileFilter());
+    if (path.isEmpty()) return;
+    
+    // Parsed and sealed on the thread pool; the vault is saved once at the end
+    const VaultCrypto *crypto = vaultCrypto;
+    QFuture<TransferResult> future = QtConcurrent::run([path, crypto](QPromise<TransferResult> &promise) {
+        promise.setProgressRange(0, 1000);
+        promise.addResult(SnippetTransfer::importFile(path, *crypto, [&promise](qint64 done, qint64 total) {
+            promise.setProgressValue(total > 0 ? int(done * 1000 / total) : 0);
+            return !promise.isCanceled();
+        }));
+    });
+    startTransfer(future, "Importing snippets...", ImportTransfer);
+}
+
+void MainWindow::exportSnippets()
+{
+    if (vaultLoading || transferWatcher->isRunning()) {
+        statusBar()->showMessage("Still loading snippets, try again in a moment.", 3000);
+        return;
+    }
+    
+    QString path = QFileDialog::getSaveFileName(this, "Export Snippets", "snippets.json", SnippetTransfer::fileFilter());
+    if (path.isEmpty()) return;
+    
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Export Snippets",
+        "The exported file holds every snippet text unencrypted. Export anyway?",
+        QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) return;
+    
+    // Texts are read from the vault, so it has to hold every edit first
+    flushSnippets(true);
+    
+    QList<TransferRecord> records;
+    records.reserve(snippetModel->rowCount());
+    for (int row = 0; row < snippetModel->rowCount(); row++) {
+        const TextSnippet *snippet = snippetModel->snippetAt(row);
+        TransferRecord record;
+        record.id = snippet->hotkeyId;
+        record.name = snippet->name;
+        record.tags = snippet->tags;
+        record.hotkey = snippetSequence(snippet).toString(QKeySequence::PortableText);
+        records.append(record);
+    }
+    
+    const VaultFile *vaultFile = vault;
+    const VaultCrypto *crypto = vaultCrypto;
+    QFuture<TransferResult> future = QtConcurrent::run([path, records, vaultFile, crypto](QPromise<TransferResult> &promise) {
+        promise.setProgressRange(0, 1000);
+        TransferResult result;
+        result.error = SnippetTransfer::exportFile(path, records, *vaultFile, *crypto, [&promise](qint64 done, qint64 total) {
+            promise.setProgressValue(total > 0 ? int(done * 1000 / total) : 0);
+            return !promise.isCanceled();
+        });
+        promise.addResult(result);
+    });
+    transferCount = records.size();
+    startTransfer(future, "Exporting snippets...", ExportTransfer);
+}
+
+void MainWindow::rotateKey()
+{
+    if (vaultLoading || transferWatcher->isRunning()) {
+        statusBar()->showMessage("Still loading snippets, try again in a moment.", 3000);
+        return;
+    }
+    
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Rotate Encryption Key",
+        "Every snippet text will be encrypted again with a new key. Continue?",
+        QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) return;
+    
+    QByteArray key = VaultCrypto::generateKey();
+    if (key.isEmpty()) {
+        QMessageBox::warning(this, "Key rotation failed", "No new key could be generated.");
+        return;
+    }
+    
+    // Texts are read from the vault, so it has to hold every edit first
+    flushSnippets(true);
+    
+    QByteArray masterKey = VaultCrypto::defaultKey();
+    pendingCrypto = new VaultCrypto(key);
+    pendingWrappedKey = VaultCrypto(masterKey).wrapKey(key);
+    SecureArena::wipe(key.data(), std::size_t(key.size()));
+    SecureArena::wipe(masterKey.data(), std::size_t(masterKey.size()));
+    rotatingKey = true;
+    
+    // Resealed on the thread pool; the vault only changes when the writer swaps it in
+    const VaultFile *vaultFile = vault;
+    const VaultCrypto *from = vaultCrypto;
+    const VaultCrypto *to = pendingCrypto;
+    QFuture<TransferResult> future = QtConcurrent::run([vaultFile, from, to](QPromise<TransferResult> &promise) {
+        promise.setProgressRange(0, 1000);
+        promise.addResult(SnippetTransfer::reseal(*vaultFile, *from, *to, [&promise](qint64 done, qint64 total) {
+            promise.setProgressValue(total > 0 ? int(done * 1000 / total) : 0);
+            return !promise.isCanceled();
+        }));
+    });
+    startTransfer(future, "Encrypting snippets with the new key...", RotateTransfer);
+}
+
+void MainWindow::startTransfer(const QFuture<TransferResult> &future, const QString &label, TransferKind kind)
+{
+    transferKind = kind;
+    transferProgress = new QProgressDialog(label, "Cancel", 0, 1000, this);
+    transferProgress->setWindowModality(Qt::WindowModal);
+    transferProgress->setMinimumDuration(300);
+    transferProgress->setAutoReset(false);
+    transferProgress->setAutoClose(false);
+    connect(transferProgress, &QProgressDialog::canceled, transferWatcher, &QFutureWatcherBase::cancel);
+    transferWatcher->setFuture(future);
+}
+
+void MainWindow::transferFinished()
+{
+    if (transferProgress) {
+        transferProgress->hide();
+        transferProgress->deleteLater();
+        transferProgress = nullptr;
+    }
+    
+    QFuture<TransferResult> future = transferWatcher->future();
+    bool finished = !future.isCanceled() && future.resultCount() > 0;
+    TransferResult result = finished ? future.result() : TransferResult();
+    if (transferKind == RotateTransfer) {
+        finishKeyRotation(result, finished && result.error.isEmpty());
+    }
+    
+    if (!finished) {
+        const char *canceled[] = { "Import canceled.", "Export canceled.", "Key rotation canceled." };
+        statusBar()->showMessage(canceled[transferKind], 3000);
+        return;
+    }
+    
+    if (!result.error.isEmpty()) {
+        const char *failed[] = { "Import failed", "Export failed", "Key rotation failed" };
+        QMessageBox::warning(this, failed[transferKind], result.error);
+        return;
+    }
+    
+    if (transferKind == ImportTransfer) {
+        addImportedSnippets(result);
+    } else if (transferKind == ExportTransfer) {
+        statusBar()->showMessage(QString("Exported %1 snippets.").arg(transferCount), 5000);
+    }
+}
+
+void MainWindow::finishKeyRotation(const TransferResult &result, bool resealed)
+{
+    bool swapped = false;
+    if (resealed) {
+        // The writer saves the resealed vault beside the old one and renames it over,
+        // so a crash leaves one whole vault or the other
+        SnippetWriter *writer = snippetWriter;
+        const QList<TransferRecord> &records = result.records;
+        const QByteArray &wrappedKey = pendingWrappedKey;
+        const VaultCrypto *crypto = pendingCrypto;
+        QMetaObject::invokeMethod(writer, [writer, &records, &wrappedKey, crypto, &swapped]() {
+            swapped = writer->rekey(records, wrappedKey, crypto);
+        }, Qt::BlockingQueuedConnection);
+    }
+    
+    if (swapped) {
+        // Decrypted texts stay valid, they don't depend on the key
+        delete vaultCrypto;
+        vaultCrypto = pendingCrypto;
+        statusBar()->showMessage(QString("Encrypted %1 snippets with the new key.").arg(result.records.size()), 5000);
+    } else {
+        delete pendingCrypto;
+        if (resealed) {
+            QMessageBox::warning(this, "Key rotation failed",
+                "The vault could not be saved with the new key. The old key is still in use.");
         }
     }
+    pendingCrypto = nullptr;
+    pendingWrappedKey.clear();
+    rotatingKey = false;
+    
+    // Edits made meanwhile go out under whichever key is current now
+    if (!dirtySnippets.isEmpty() || !removedSnippets.isEmpty()) {
+        saveTimer->start();
+    }
+}
+
+void MainWindow::addImportedSnippets(const TransferResult &result)
+{
+    if (result.records.isEmpty()) {
+        QMessageBox::information(this, "Import", "The file holds no snippets.");
+        return;
+    }
+    
+    if (result.records.size() > MaxSnippetId - nextHotkeyId + 1) {
+        QMessageBox::warning(this, "Import failed", "The vault has no room for that many more snippets.");
+        return;
+    }
+    
+    // Only ids and hotkeys are left to do here; the texts were sealed on the pool
+    QList<VaultRecord> added;
+    added.reserve(result.records.size());
+    int id = nextHotkeyId;
+    for (const TransferRecord &imported : result.records) {
+        VaultRecord record;
+        record.id = id++;
+        record.name = imported.name;
+        record.tags = imported.tags;
+        record.body = imported.body;
+        QKeySequence keySeq(imported.hotkey, QKeySequence::PortableText);
+        if (!keySeq.isEmpty()) {
+            record.hotkeyModifiers = hotkeyModifiers(keySeq[0].keyboardModifiers());
+            record.hotkeyKey = keySeq[0].key();
+            record.hotkeyTail = sequenceTail(keySeq).toString(QKeySequence::PortableText);
+        }
+        added.append(record);
+    }
+    
+    // One save for the whole import, after any pending edits. It has to be done
+    // before the snippets are listed, since their texts are read from the vault.
+    flushSnippets(false);
+    bool saved = false;
+    int generation = ++writeGeneration;
+    SnippetWriter *writer = snippetWriter;
+    QMetaObject::invokeMethod(writer, [writer, &added, &saved, generation]() {
+        saved = writer->add(added, generation);
+    }, Qt::BlockingQueuedConnection);
+    if (!saved) {
+        QMessageBox::warning(this, "Import failed", "The imported snippets could not be saved to the vault.");
+        return;
+    }
+    
+    // Listed and bound in one batch, the same way the vault is loaded
+    loadConflicts.clear();
+    snippetsLoaded(added);
+    reportHotkeyConflicts(loadConflicts);
+    loadConflicts.clear();
+    
+    QString message = QString("Imported %1 snippets.").arg(added.size());
+    if (result.skipped > 0) {
+        message += QString(" %1 entries without a name were skipped.").arg(result.skipped);
+    }
+    statusBar()->showMessage(message, 5000);
 }
 
 void MainWindow::unregisterAllHotKeys()
 {
+    hotkeys->unbindAll();
+    chords->clear();
     for (const auto& snippet : snippets) {
-        UnregisterHotKey((HWND)winId(), snippet->hotkeyId);
+        snippet->hotkeyActive = false;
     }
 }
 
 bool MainWindow::nativeEvent(const QByteArray &eventType, void *message, qintptr *result)
 {
+#ifdef Q_OS_WIN
     MSG* msg = static_cast<MSG*>(message);
     if (msg->message == WM_HOTKEY) {
-        int id = static_cast<int>(msg->wParam);
-        sendKeystroke(id);
+        int id = hotkeys->idForSystemId(static_cast<int>(msg->wParam));
+        if (id < 0) {
+            return true;
+        }
+        if (id == PaletteHotkeyId) {
+            showQuickPalette();
+        } else if (isLeaderHotkeyId(id)) {
+            chords->begin(id - LeaderHotkeyIdBase);
+        } else {
+            fireSnippet(id);
+        }
         return true;
     }
-    return false;
+#endif
+    return QMainWindow::nativeEvent(eventType, message, result);
 }
 
-void MainWindow::sendKeystroke(int snippetId)
+bool MainWindow::snippetTemplate(int snippetId, SnippetTemplate &compiled)
 {
-    QString textToSend;
-    
     if (snippetId == -1) {
         // Test button was pressed, use current input
-        textToSend = textInput->text();
-        if (textToSend.isEmpty()) {
+        QString text = textInput->text();
+        if (text.isEmpty()) {
             QMessageBox::warning(this, "No Text", "Please enter some text first.");
-            return;
-        }
-    } else {
-        // Hotkey was pressed, find the snippet
-        if (!snippets.contains(snippetId)) {
-            QMessageBox::warning(this, "Error", "Snippet not found.");
-            return;
+            return false;
         }
-        textToSend = snippets[snippetId]->text;
+        compiled = SnippetTemplate(SecretBuffer::share(text));
+        return true;
     }
     
-    // Ask user for typing target
-    QMessageBox msgBox;
-    msgBox.setText("Click in the target window where you want to type, then press OK.");
-    msgBox.exec();
+    if (!snippets.contains(snippetId)) {
+        QMessageBox::warning(this, "Error", "Snippet not found.");
+        return false;
+    }
+    decryptSnippetText(snippets[snippetId]);
+    compiled = snippets[snippetId]->textTemplate;
+    return true;
+}
+
+void MainWindow::fireSnippet(int snippetId)
+{
+    if (!config->values().directFire) {
+        sendKeystroke(snippetId);
+        return;
+    }
     
-    // Use QTimer instead of Sleep to avoid blocking UI thread
-    QTimer::singleShot(1500, this, [this, textToSend, snippetId]() {
-        // Ensure the target application has focus before typing
-        HWND foregroundWindow = GetForegroundWindow();
-        if (foregroundWindow == nullptr || foregroundWindow == (HWND)this->winId()) {
-            QMessageBox::warning(this, "Error", "Failed to detect target window. Please try again.");
-            return;
+    // The window that had focus when the hotkey was pressed is the target
+    cancelTargetWait("Typing into the hotkey's window instead.");
+    SnippetTemplate compiled;
+    if (!snippetTemplate(snippetId, compiled)) return;
+    
+    SnippetTemplate::Expansion expansion = compiled.expand();
+    sendText(expansion.text, snippetId, expansion.caretBack, true);
+}
+
+QString MainWindow::typeRequested(const QString &target)
+{
+    // Ids are tried first, then names
+    bool isId = false;
+    int snippetId = target.toInt(&isId);
+    if (!isId || !snippets.contains(snippetId)) {
+        QList<int> ids = snippetIdsByName.values(target);
+        if (ids.isEmpty()) {
+            return QString("No snippet named \"%1\".").arg(target);
         }
-        
-        sendText(textToSend);
-        
-        // Auto-clear if enabled
-        if (autoClear && snippetId != -1 && snippets.contains(snippetId)) {
-            // Clear the text from memory securely
-            snippets[snippetId]->text.fill('0');
-            snippets[snippetId]->text.clear();
-            saveSnippets();
-            QMessageBox::information(this, "Auto-Clear", 
-                "The text has been typed and cleared from memory for security.");
+        if (ids.size() > 1) {
+            return QString("%1 snippets are named \"%2\", use the id instead.").arg(ids.size()).arg(target);
         }
-    });
+        snippetId = ids.first();
+    }
+    
+    if (typingJob != 0) {
+        return "Another snippet is still being typed.";
+    }
+    
+    // Like a hotkey: typed into whatever window has focus, without waiting for a pick
+    cancelTargetWait("Typing into the focused window instead.");
+    SnippetTemplate compiled;
+    if (!snippetTemplate(snippetId, compiled)) {
+        return "Snippet not found.";
+    }
+    SnippetTemplate::Expansion expansion = compiled.expand();
+    if (!expansion.text || expansion.text->isEmpty()) {
+        return "The snippet is empty.";
+    }
+    sendText(expansion.text, snippetId, expansion.caretBack, true);
+    return QString();
+}
+
+void MainWindow::sendKeystroke(int snippetId)
+{
+    SnippetTemplate textToSend;
+    if (!snippetTemplate(snippetId, textToSend)) return;
+    
+    if (typingJob != 0) {
+        QMessageBox::warning(this, "Busy", "Another snippet is still being typed. Stop it first.");
+        return;
+    }
+    
+    // Type as soon as the user switches to another application's window
+    targetText = textToSend;
+    targetSnippetId = snippetId;
+    typingStatusLabel->setText("Click the window to type into...");
+    typingStatusLabel->show();
+    stopTypingButton->show();
+    if (stopTypingAction) {
+        stopTypingAction->setEnabled(true);
+    }
+    if (!isVisible() && trayIcon) {
+        trayIcon->showMessage("KeyGhost", "Click the window to type into.",
+                              QSystemTrayIcon::Information, 3000);
+    }
+    targetTimeout->start();
+    foregroundWatcher->start();
 }
 
-void MainWindow::sendText(const QString &text)
+void MainWindow::targetWindowActivated()
 {
-    // Option to use clipboard instead of typing
-    if (settings.value("UseClipboard", false).toBool()) {
-        copyToClipboard(text);
+    targetTimeout->stop();
+    
+    // Placeholders are filled in now; the template itself was parsed when the text was loaded
+    SnippetTemplate::Expansion expansion = targetText.expand();
+    int snippetId = targetSnippetId;
+    targetText = SnippetTemplate();
+    targetSnippetId = -1;
+    
+    typingStatusLabel->hide();
+    stopTypingButton->hide();
+    sendText(expansion.text, snippetId, expansion.caretBack);
+}
+
+void MainWindow::cancelTargetWait(const QString &message)
+{
+    if (!foregroundWatcher->isWatching()) return;
+    
+    foregroundWatcher->stop();
+    targetTimeout->stop();
+    targetText = SnippetTemplate();
+    targetSnippetId = -1;
+    
+    typingStatusLabel->hide();
+    stopTypingButton->hide();
+    if (stopTypingAction) {
+        stopTypingAction->setEnabled(false);
+    }
+    statusBar()->showMessage(message, 3000);
+}
+
+void MainWindow::sendText(const SecretText &text, int snippetId, int caretBack, bool afterHotkey)
+{
+    if (!text || text->isEmpty()) {
+        statusBar()->showMessage("The snippet is empty.", 3000);
+        return;
+    }
+    
+    // Plain fields, nothing is looked up in QSettings per send
+    const AppSettings &values = config->values();
+    if (values.delivery == AppSettings::DeliverCopy) {
+        // QMimeData keeps the string, so it gets a copy that outlives the buffer
+        copyToClipboard(text->text().toString());
         QMessageBox::information(this, "Clipboard", 
             "Text has been copied to clipboard. Press Ctrl+V to paste.");
+        snippetSent(snippetId);
         return;
     }
 
-    // Improved input sending method
-    INPUT input;
+    if (!injectionWorker) {
+        QMessageBox::warning(this, "Error", "Keystroke simulation is not available on this system.");
+        return;
+    }
     
-    // Get current typing delay from settings
-    int currentDelay = settings.value("TypingDelay", typingDelay).toInt();
+    if (typingJob != 0) {
+        QMessageBox::warning(this, "Busy", "Another snippet is still being typed. Stop it first.");
+        return;
+    }
     
-    // For each character in the string
-    for (QChar c : text) {
-        // Get virtual key code and scan code for the character
-        SHORT vkScan = VkKeyScanW(c.unicode());
-        WORD vkCode = vkScan & 0xFF;
-        BOOL needShift = vkScan & 0x100;
-        
-        if (vkCode == 0xFF) {
-            // Character can't be typed with a normal keystroke
-            // Use the KEYEVENTF_UNICODE flag for direct Unicode input
-            INPUT unicodeInput[2];
-            ZeroMemory(unicodeInput, sizeof(unicodeInput));
-            
-            // Key down event
-            unicodeInput[0].type = INPUT_KEYBOARD;
-            unicodeInput[0].ki.wVk = 0;
-            unicodeInput[0].ki.wScan = c.unicode();
-            unicodeInput[0].ki.dwFlags = KEYEVENTF_UNICODE;
-            
-            // Key up event
-            unicodeInput[1].type = INPUT_KEYBOARD;
-            unicodeInput[1].ki.wVk = 0;
-            unicodeInput[1].ki.wScan = c.unicode();
-            unicodeInput[1].ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
-            
-            SendInput(2, unicodeInput, sizeof(INPUT));
-        } else {
-            // Normal character input sequence
-            std::vector<INPUT> inputs;
-            
-            // Press Shift if needed
-            if (needShift) {
-                ZeroMemory(&input, sizeof(INPUT));
-                input.type = INPUT_KEYBOARD;
-                input.ki.wVk = VK_SHIFT;
-                inputs.push_back(input);
-            }
-            
-            // Press the key
-            ZeroMemory(&input, sizeof(INPUT));
-            input.type = INPUT_KEYBOARD;
-            input.ki.wVk = vkCode;
-            inputs.push_back(input);
-            
-            // Release the key
-            input.ki.dwFlags = KEYEVENTF_KEYUP;
-            inputs.push_back(input);
-            
-            // Release Shift if it was pressed
-            if (needShift) {
-                ZeroMemory(&input, sizeof(INPUT));
-                input.type = INPUT_KEYBOARD;
-                input.ki.wVk = VK_SHIFT;
-                input.ki.dwFlags = KEYEVENTF_KEYUP;
-                inputs.push_back(input);
-            }
-            
-            SendInput(inputs.size(), inputs.data(), sizeof(INPUT));
-        }
-        
-        // Non-blocking delay between keystrokes
-        QThread::msleep(currentDelay);
+    // Pasting costs the same at any length, typing grows with it
+    bool paste = values.delivery == AppSettings::DeliverPaste
+        || (values.delivery == AppSettings::DeliverAuto && text->text().size() >= values.pasteThreshold);
+    
+    // Get current typing pace from settings
+    InjectionOptions options;
+    // Delays are stored in milliseconds with microsecond fractions
+    options.delayUs = qRound(values.typingDelay * 1000);
+    options.burst = values.burstMode;
+    options.chunkSize = values.burstChunkSize;
+    options.chunkDelayUs = qRound(values.burstChunkDelay * 1000);
+    options.releaseWaitMs = afterHotkey ? 1000 : 0;
+    
+    typingJob = ++lastTypingJob;
+    typingSnippetId = snippetId;
+    
+    typingStatusLabel->setText(paste ? QString("Pasting...") : QString("Typing... 0/%1").arg(text->text().size()));
+    typingStatusLabel->show();
+    stopTypingButton->show();
+    if (stopTypingAction) {
+        stopTypingAction->setEnabled(true);
+    }
+    
+    // Hand the text to the worker thread; progress and completion come back as signals
+    InjectionWorker *worker = injectionWorker;
+    int job = typingJob;
+    if (paste) {
+        // The user's clipboard is put back once the target has read the text
+        pasteJob = job;
+        clipboardGuard->stash(text->text().toString());
+        options.burst = true;
+        options.chunkSize = 0;
+        QMetaObject::invokeMethod(worker, [worker, job, options, caretBack]() {
+            worker->pasteClipboard(job, options, caretBack);
+        }, Qt::QueuedConnection);
+        return;
     }
+    
+    QMetaObject::invokeMethod(worker, [worker, job, text, options, snippetId, caretBack]() {
+        worker->typeText(job, text, options, snippetId, caretBack);
+    }, Qt::QueuedConnection);
 }
 
-void MainWindow::createTrayIcon()
+void MainWindow::forgetCachedPlan(int snippetId)
+{
+    if (!injectionWorker) return;
+    
+    // Compiled plans hold the snippet's keystrokes, drop them with the text
+    InjectionWorker *worker = injectionWorker;
+    QMetaObject::invokeMethod(worker, [worker, snippetId]() {
+        worker->forgetPlan(snippetId);
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::stopTyping()
 {
-    // Delete old menu if it exists to prevent memory leaks
-    if (trayIcon && trayIcon->contextMenu()) {
-        delete trayIcon->contextMenu();
+    cancelTargetWait("Typing cancelled.");
+    if (injectionWorker && typingJob != 0) {
+        injectionWorker->cancel(typingJob);
     }
+}
+
+void MainWindow::typingProgress(int job, int typed, int total)
+{
+    if (job != typingJob || job == pasteJob) return;
     
-    // Create new menu
+    typingStatusLabel->setText(QString("Typing... %1/%2").arg(typed).arg(total));
+}
+
+void MainWindow::typingFinished(int job, bool completed)
+{
+    if (job != typingJob) return;
+    
+    int snippetId = typingSnippetId;
+    typingJob = 0;
+    typingSnippetId = -1;
+    
+    if (job == pasteJob) {
+        pasteJob = 0;
+        clipboardGuard->restoreLater(PasteRestoreDelayMs);
+    }
+    
+    typingStatusLabel->hide();
+    stopTypingButton->hide();
+    if (stopTypingAction) {
+        stopTypingAction->setEnabled(false);
+    }
+    
+    if (completed) {
+        snippetSent(snippetId);
+    } else {
+        statusBar()->showMessage("Typing stopped before the end of the text.", 3000);
+    }
+}
+
+void MainWindow::typingPaced(int job, double charsPerSecond, double jitterUs, double maxLateUs)
+{
+    if (job != typingJob) return;
+    
+    statusBar()->showMessage(QString("Typed at %1 characters/s, jitter %2 ms (at most %3 ms late)")
+                                 .arg(charsPerSecond, 0, 'f', 1)
+                                 .arg(jitterUs / 1000.0, 0, 'f', 3)
+                                 .arg(maxLateUs / 1000.0, 0, 'f', 3), 5000);
+}
+
+void MainWindow::snippetSent(int snippetId)
+{
+    // Auto-clear if enabled
+    if (config->values().autoClear && snippetId != -1 && snippets.contains(snippetId)) {
+        // Dropping the last reference wipes the secure buffer
+        snippets[snippetId]->textTemplate.clear();
+        snippets[snippetId]->text.reset();
+        forgetCachedPlan(snippetId);
+        markSnippetDirty(snippetId, true);
+        QMessageBox::information(this, "Auto-Clear", 
+            "The text has been typed and cleared from memory for security.");
+    }
+}
+
+void MainWindow::createTrayIcon()
+{
+    // The menu is built once; the snippet submenu follows the list model by itself
     QMenu *trayMenu = new QMenu(this);
     QAction *showAction = trayMenu->addAction("Show");
     trayMenu->addSeparator();
     
-    // Add snippets to tray menu
-    if (!snippets.isEmpty()) {
-        QMenu *snippetsMenu = trayMenu->addMenu("Type Snippets");
-        for (const auto& snippet : snippets) {
-            if (snippet && !snippet->name.isEmpty()) {
-                QAction *snippetAction = snippetsMenu->addAction(snippet->name);
-                connect(snippetAction, &QAction::triggered, [this, id = snippet->hotkeyId]() {
-                    sendKeystroke(id);
-                });
-            }
-        }
-        trayMenu->addSeparator();
-    }
+    SnippetTrayMenu *snippetsMenu = new SnippetTrayMenu(snippetModel, trayMenu);
+    connect(snippetsMenu, &SnippetTrayMenu::snippetTriggered, this, &MainWindow::sendKeystroke);
+    trayMenu->addMenu(snippetsMenu);
+    QAction *paletteAction = trayMenu->addAction("Quick Launch...");
+    connect(paletteAction, &QAction::triggered, this, &MainWindow::showQuickPalette);
+    trayMenu->addSeparator();
+    
+    stopTypingAction = trayMenu->addAction("Stop Typing");
+    stopTypingAction->setEnabled(typingJob != 0);
+    connect(stopTypingAction, &QAction::triggered, this, &MainWindow::stopTyping);
     
     QAction *quitAction = trayMenu->addAction("Quit");
     
     connect(showAction, &QAction::triggered, this, &QWidget::show);
     connect(quitAction, &QAction::triggered, qApp, &QCoreApplication::quit);
     
-    // Create or update tray icon
-    if (!trayIcon) {
-        trayIcon = new QSystemTrayIcon(this);
-        trayIcon->setIcon(QApplication::style()->standardIcon(QStyle::SP_ComputerIcon));
-        connect(trayIcon, &QSystemTrayIcon::activated, this, &MainWindow::restoreFromTray);
-    }
+    trayIcon = new QSystemTrayIcon(this);
+    trayIcon->setIcon(QApplication::style()->standardIcon(QStyle::SP_ComputerIcon));
+    connect(trayIcon, &QSystemTrayIcon::activated, this, &MainWindow::restoreFromTray);
     
     trayIcon->setContextMenu(trayMenu);
     trayIcon->show();
@@ -421,6 +1198,12 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
 void MainWindow::addNewSnippet()
 {
+    // New ids are only known to be free once the whole vault is listed
+    if (vaultLoading) {
+        statusBar()->showMessage("Still loading snippets, try again in a moment.", 3000);
+        return;
+    }
+    
     // Replace QInputDialog::getText with a simple custom dialog
     QDialog dialog(this);
     dialog.setWindowTitle("New Snippet");
@@ -457,6 +1240,19 @@ void MainWindow::addNewSnippet()
         return; // User canceled or entered empty text
     }
     
+    if (snippetIdsByName.contains(name)) {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Duplicate Name",
+            QString("A snippet named \"%1\" already exists. Add another one?").arg(name),
+            QMessageBox::Yes | QMessageBox::No);
+        if (reply != QMessageBox::Yes) {
+            return;
+        }
+    }
+    
+    if (nextHotkeyId > MaxSnippetId) {
+        QMessageBox::warning(this, "Add Snippet", "No more snippet ids are left.");
+        return;
+    }
     int id = nextHotkeyId++;
     
     // Convert QKeySequence to Windows hotkey format
@@ -464,54 +1260,51 @@ void MainWindow::addNewSnippet()
     int key = 0;
     
     if (!keySeq.isEmpty()) {
-        int qtKey = keySeq[0] & ~Qt::KeyboardModifierMask;
-        
-        // Handle modifiers
-        if (keySeq[0] & Qt::AltModifier)     mod |= MOD_ALT;
-        if (keySeq[0] & Qt::ControlModifier) mod |= MOD_CONTROL;
-        if (keySeq[0] & Qt::ShiftModifier)   mod |= MOD_SHIFT;
-        if (keySeq[0] & Qt::MetaModifier)    mod |= MOD_WIN;
+        mod = hotkeyModifiers(keySeq[0].keyboardModifiers());
         
         // Map Qt key to Windows VK
-        key = qtKey;
+        key = keySeq[0].key();
     } else {
-        // Default hotkey (Alt+1, Alt+2, etc.)
+        // Default hotkey: the first free one of Alt+1 .. Alt+9
         mod = MOD_ALT;
         key = 0x31 + snippets.size() % 9; // Number keys 1-9
+        for (int digit = 0x31; digit <= 0x39; digit++) {
+            if (hotkeys->ownerOf(MOD_ALT, digit) < 0) {
+                key = digit;
+                break;
+            }
+        }
     }
     
-    TextSnippet *snippet = new TextSnippet(name, "", mod, key, id);
-    snippets[id] = snippet;
+    TextSnippet *snippet = new TextSnippet(name, mod, key, id);
+    snippet->hotkeyTail = sequenceTail(keySeq);
+    insertSnippet(snippet);
     
     // Update UI with name and hotkey
-    QListWidgetItem *item = new QListWidgetItem();
-    snippetList->addItem(item);
-    updateSnippetListItem(snippetList->count() - 1, snippet);
-    snippetList->setCurrentRow(snippetList->count() - 1);
+    snippetModel->appendSnippet(snippet);
+    snippetList->setCurrentIndex(snippetModel->index(snippetModel->rowOf(id)));
     
     // Register hotkey
-    registerHotKey(snippet);
+    HotkeyRegistry::Conflict conflict;
+    if (!registerHotKey(snippet, &conflict)) {
+        reportHotkeyConflicts({ conflict });
+    }
+    snippetModel->snippetChanged(id);
     
-    // Save snippets
-    saveSnippets();
+    // Save the new snippet
+    markSnippetDirty(id, true);
 }
 
 void MainWindow::editSelectedSnippet()
 {
-    int row = snippetList->currentRow();
+    int row = currentSnippetRow();
     if (row >= 0) {
-        int id = -1;
-        for (auto it = snippets.begin(); it != snippets.end(); ++it) {
-            if (it.value()->name == snippetList->item(row)->text().split(" [")[0]) {
-                id = it.key();
-                break;
-            }
-        }
-        
-        if (id != -1) {
-            TextSnippet *snippet = snippets[id];
+        TextSnippet *snippet = snippetAt(row);
+        if (snippet) {
+            int id = snippet->hotkeyId;
+            decryptSnippetText(snippet);
             nameInput->setText(snippet->name);
-            textInput->setText(snippet->text);
+            textInput->setText(snippet->textView().toString());
             
             // Add hotkey editing dialog
             QDialog hotkeyDialog(this);
@@ -520,22 +1313,11 @@ void MainWindow::editSelectedSnippet()
             
             QVBoxLayout *layout = new QVBoxLayout(&hotkeyDialog);
             
-            QLabel *label = new QLabel("Press the keys for the new hotkey:", &hotkeyDialog);
+            QLabel *label = new QLabel("Press the keys for the new hotkey or sequence:", &hotkeyDialog);
             QKeySequenceEdit *hotkeyEdit = new QKeySequenceEdit(&hotkeyDialog);
             
-            // Set current hotkey if possible
-            int virtualKey = snippet->hotkeyKey;
-            int modifiers = snippet->hotkeyModifiers;
-            
-            // Convert Windows modifiers to Qt modifiers
-            Qt::KeyboardModifiers qtMods = Qt::NoModifier;
-            if (modifiers & MOD_ALT) qtMods |= Qt::AltModifier;
-            if (modifiers & MOD_CONTROL) qtMods |= Qt::ControlModifier;
-            if (modifiers & MOD_SHIFT) qtMods |= Qt::ShiftModifier;
-            if (modifiers & MOD_WIN) qtMods |= Qt::MetaModifier;
-            
-            QKeySequence currentSeq(qtMods | virtualKey);
-            hotkeyEdit->setKeySequence(currentSeq);
+            // Set current hotkey and sequence tail if possible
+            hotkeyEdit->setKeySequence(snippetSequence(snippet));
             
             QDialogButtonBox *buttonBox = new QDialogButtonBox(
                 QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, &hotkeyDialog);
@@ -550,36 +1332,38 @@ void MainWindow::editSelectedSnippet()
             if (hotkeyDialog.exec() == QDialog::Accepted) {
                 QKeySequence keySeq = hotkeyEdit->keySequence();
                 if (!keySeq.isEmpty()) {
-                    // Unregister old hotkey
-                    UnregisterHotKey((HWND)winId(), snippet->hotkeyId);
-                    
                     // Convert QKeySequence to Windows hotkey format
-                    int mod = 0;
-                    int key = 0;
-                    
-                    int qtKey = keySeq[0] & ~Qt::KeyboardModifierMask;
-                    
-                    // Handle modifiers
-                    if (keySeq[0] & Qt::AltModifier)     mod |= MOD_ALT;
-                    if (keySeq[0] & Qt::ControlModifier) mod |= MOD_CONTROL;
-                    if (keySeq[0] & Qt::ShiftModifier)   mod |= MOD_SHIFT;
-                    if (keySeq[0] & Qt::MetaModifier)    mod |= MOD_WIN;
+                    int mod = hotkeyModifiers(keySeq[0].keyboardModifiers());
                     
                     // Map Qt key to Windows VK
-                    key = qtKey;
+                    int key = keySeq[0].key();
+                    QKeySequence tail = sequenceTail(keySeq);
+                    
+                    // Refuse a chord another snippet already uses; a sequence may
+                    // share its first chord with other sequences
+                    int owner = hotkeys->ownerOf(mod, key);
+                    if (owner >= 0 && owner != id && !(isLeaderHotkeyId(owner) && !tail.isEmpty())) {
+                        reportHotkeyConflicts({ { id, mod, key, owner } });
+                        return;
+                    }
                     
                     // Update snippet
+                    unregisterHotKey(snippet);
                     snippet->hotkeyModifiers = mod;
                     snippet->hotkeyKey = key;
+                    snippet->hotkeyTail = tail;
                     
                     // Register new hotkey
-                    registerHotKey(snippet);
+                    HotkeyRegistry::Conflict conflict;
+                    if (!registerHotKey(snippet, &conflict)) {
+                        reportHotkeyConflicts({ conflict });
+                    }
                     
                     // Update list display
-                    updateSnippetListItem(row, snippet);
+                    snippetModel->snippetChanged(id);
                     
                     // Save changes
-                    saveSnippets();
+                    markSnippetDirty(id);
                 }
             }
         }
@@ -588,63 +1372,43 @@ void MainWindow::editSelectedSnippet()
 
 void MainWindow::deleteSelectedSnippet()
 {
-    int row = snippetList->currentRow();
+    int row = currentSnippetRow();
     if (row >= 0) {
-        int id = -1;
-        for (auto it = snippets.begin(); it != snippets.end(); ++it) {
-            if (it.value()->name == snippetList->item(row)->text().split(" [")[0]) {
-                id = it.key();
-                break;
-            }
-        }
-        
-        if (id != -1) {
-            // Unregister hotkey
-            UnregisterHotKey((HWND)winId(), snippets[id]->hotkeyId);
+        TextSnippet *snippet = snippetAt(row);
+        if (snippet) {
+            int id = snippet->hotkeyId;
             
-            // Remove from memory
-            delete snippets[id];
-            snippets.remove(id);
+            // Unregister hotkey
+            unregisterHotKey(snippet);
             
-            // Update UI
-            delete snippetList->takeItem(row);
+            // Remove from the list and memory
+            forgetCachedPlan(id);
+            removeSnippet(id);
             
             // Save changes
-            saveSnippets();
+            markSnippetRemoved(id);
         }
     }
 }
 
 void MainWindow::snippetSelected(int index)
 {
-    if (index >= 0) {
-        QString fullText = snippetList->item(index)->text();
-        // Retrieve only name without hotkey
-        QString name = fullText.split(" [")[0];
-        
-        for (const auto& snippet : snippets) {
-            if (snippet->name == name) {
-                nameInput->setText(snippet->name);
-                textInput->setText(snippet->text);
-                return;
-            }
-        }
+    TextSnippet *snippet = snippetAt(index);
+    if (snippet) {
+        selectedSnippetId = snippet->hotkeyId;
+        decryptSnippetText(snippet);
+        nameInput->setText(snippet->name);
+        textInput->setText(snippet->textView().toString());
+        tagsInput->setText(snippet->tags.join(", "));
+        return;
     }
+    selectedSnippetId = -1;
 }
 
 void MainWindow::openSettings()
 {
     if (!settingsDialog) {
-        settingsDialog = new SettingsDialog(this);
-        connect(settingsDialog, &QDialog::accepted, [this]() {
-            // Apply settings
-            maskText = settings.value("MaskText", false).toBool();
-            typingDelay = settings.value("TypingDelay", 30).toInt();
-            autoClear = settings.value("AutoClear", false).toBool();
-            
-            // Update text masking
-            textInput->setEchoMode(maskText ? QLineEdit::Password : QLineEdit::Normal);
-        });
+        settingsDialog = new SettingsDialog(config, this);
     }
     
     settingsDialog->show();
@@ -652,141 +1416,304 @@ void MainWindow::openSettings()
     settingsDialog->activateWindow();
 }
 
+void MainWindow::settingsChanged()
+{
+    forgetIdleTexts();
+    chords->setTimeout(config->values().sequenceTimeout);
+    HotkeyRegistry::Conflict conflict;
+    if (!registerPaletteHotKey(&conflict)) {
+        reportHotkeyConflicts({ conflict });
+    }
+    
+    // Update text masking
+    textInput->setEchoMode(config->values().maskText ? QLineEdit::Password : QLineEdit::Normal);
+}
+
 void MainWindow::saveSnippets()
 {
     // Save current snippet if editing
-    int currentRow = snippetList->currentRow();
-    if (currentRow >= 0) {
-        QString name = snippetList->item(currentRow)->text().split(" [")[0]; // Get only name without hotkey
-        for (auto& snippet : snippets) {
-            if (snippet->name == name) {
-                // Update with current values
-                QString newName = nameInput->text();
-                snippet->name = newName;
-                snippet->text = textInput->text();
-                
-                // Update list item if name changed
-                if (name != newName) {
-                    updateSnippetListItem(currentRow, snippet);
-                }
-                break;
+    TextSnippet *snippet = snippetAt(currentSnippetRow());
+    if (snippet) {
+        // Update with current values
+        QString newName = nameInput->text();
+        QString newText = textInput->text();
+        QStringList newTags;
+        for (const QString &tag : tagsInput->text().split(',', Qt::SkipEmptyParts)) {
+            if (!tag.trimmed().isEmpty()) {
+                newTags.append(tag.trimmed());
+            }
+        }
+        bool nameChanged = newName != snippet->name;
+        bool textChanged = newText != snippet->textView();
+        bool tagsChanged = newTags != snippet->tags;
+        if (nameChanged || textChanged || tagsChanged) {
+            snippet->tags = newTags;
+            renameSnippet(snippet, newName);
+            if (textChanged) {
+                snippet->text = SecretBuffer::share(newText);
+                snippet->textTemplate = SnippetTemplate(snippet->text);
+            }
+            markSnippetDirty(snippet->hotkeyId, textChanged);
+            
+            // Update list item and tray menu if name changed
+            if (nameChanged) {
+                snippetModel->snippetChanged(snippet->hotkeyId);
             }
         }
     }
     
-    // Save all snippets to settings
-    settings.beginGroup("Snippets");
-    settings.remove(""); // Clear existing settings
+    // Explicit saves don't wait for the debounce
+    flushSnippets(false);
+}
+
+void MainWindow::markSnippetDirty(int id, bool textChanged)
+{
+    removedSnippets.remove(id);
+    dirtySnippets.insert(id);
+    if (textChanged) {
+        changedTexts.insert(id);
+        touchSnippetText(id);
+    }
+    if (!saveTimer->isActive()) {
+        saveTimer->start();
+    }
+}
+
+void MainWindow::markSnippetRemoved(int id)
+{
+    dirtySnippets.remove(id);
+    changedTexts.remove(id);
+    unwrittenTexts.remove(id);
+    decryptedTexts.remove(id);
+    removedSnippets.insert(id);
+    if (!saveTimer->isActive()) {
+        saveTimer->start();
+    }
+}
+
+void MainWindow::flushSnippets(bool wait)
+{
+    saveTimer->stop();
+    if (dirtySnippets.isEmpty() && removedSnippets.isEmpty()) {
+        return;
+    }
+    if (rotatingKey && !wait) {
+        // Held until the resealed vault is in place
+        return;
+    }
     
-    int index = 0;
-    for (const auto& snippet : snippets) {
-        settings.beginGroup(QString::number(index));
-        settings.setValue("Name", snippet->name);
-        settings.setValue("Text", encrypt(snippet->text));
-        settings.setValue("ModKeys", snippet->hotkeyModifiers);
-        settings.setValue("Key", snippet->hotkeyKey);
-        settings.setValue("Id", snippet->hotkeyId);
-        settings.endGroup();
-        index++;
+    // Snapshot the changed snippets; encryption and I/O happen on the writer thread
+    QList<SnippetRecord> changed;
+    changed.reserve(dirtySnippets.size());
+    for (int id : std::as_const(dirtySnippets)) {
+        TextSnippet *snippet = snippets.value(id);
+        if (!snippet) continue;
+        
+        SnippetRecord record;
+        record.id = id;
+        record.name = snippet->name;
+        record.hotkeyModifiers = snippet->hotkeyModifiers;
+        record.hotkeyKey = snippet->hotkeyKey;
+        record.tags = snippet->tags;
+        record.hotkeyTail = snippet->hotkeyTail.toString(QKeySequence::PortableText);
+        record.textChanged = changedTexts.contains(id);
+        if (record.textChanged) {
+            record.text = snippet->text;
+        }
+        changed.append(record);
     }
     
-    settings.endGroup();
-    settings.sync();
+    QList<int> removed = removedSnippets.values();
     
-    // Update the tray menu
-    createTrayIcon();
+    // Texts can't be forgotten until the vault holds them
+    int generation = ++writeGeneration;
+    for (int id : std::as_const(changedTexts)) {
+        unwrittenTexts.insert(id, generation);
+    }
+    
+    dirtySnippets.clear();
+    changedTexts.clear();
+    removedSnippets.clear();
+    
+    SnippetWriter *writer = snippetWriter;
+    QMetaObject::invokeMethod(writer, [writer, changed, removed, generation]() {
+        writer->write(changed, removed, generation);
+    }, wait ? Qt::BlockingQueuedConnection : Qt::QueuedConnection);
 }
 
-void MainWindow::loadSnippets()
+void MainWindow::snippetsWritten(int generation)
 {
-    // Clear existing snippets
-    snippetList->clear();
-    for (auto snippet : snippets) {
-        delete snippet;
+    writtenGeneration = generation;
+    for (auto it = unwrittenTexts.begin(); it != unwrittenTexts.end();) {
+        if (it.value() <= generation) {
+            it = unwrittenTexts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void MainWindow::touchSnippetText(int id)
+{
+    decryptedTexts.insert(id, QDateTime::currentMSecsSinceEpoch());
+    if (config->values().forgetTextAfter > 0 && !forgetTextTimer->isActive()) {
+        forgetTextTimer->start();
+    }
+}
+
+bool MainWindow::decryptSnippetText(TextSnippet *snippet)
+{
+    int id = snippet->hotkeyId;
+    bool alreadyDecrypted = decryptedTexts.contains(id);
+    touchSnippetText(id);
+    if (alreadyDecrypted) {
+        return true;
     }
-    snippets.clear();
     
-    // Apply settings first
-    maskText = settings.value("MaskText", false).toBool();
-    typingDelay = settings.value("TypingDelay", 30).toInt();
-    autoClear = settings.value("AutoClear", false).toBool();
+    QByteArray body = vault->body(id);
+    if (body.isEmpty()) {
+        return true;
+    }
     
-    textInput->setEchoMode(maskText ? QLineEdit::Password : QLineEdit::Normal);
+    // Straight into secure memory; the template parses the same buffer
+    SecretBuffer plain;
+    if (!vaultCrypto->openText(body, plain)) {
+        qWarning("Decryption error for the snippet: %s", qPrintable(snippet->name));
+        return false;
+    }
+    snippet->text = SecretBuffer::share(std::move(plain));
+    snippet->textTemplate = SnippetTemplate(snippet->text);
+    return true;
+}
 
-    // Load snippets from settings
-    settings.beginGroup("Snippets");
-    QStringList groups = settings.childGroups();
-    
-    // Checking for possible duplicate IDs
-    QSet<int> usedIds;
+void MainWindow::forgetIdleTexts()
+{
+    const int forgetTextAfter = config->values().forgetTextAfter;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = decryptedTexts.begin(); it != decryptedTexts.end();) {
+        int id = it.key();
+        
+        // Keep texts that are open in the editor, being typed or not saved yet
+        bool inUse = id == selectedSnippetId || id == typingSnippetId || id == targetSnippetId
+            || changedTexts.contains(id) || unwrittenTexts.contains(id);
+        if (forgetTextAfter <= 0 || inUse || now - it.value() < forgetTextAfter * 1000LL) {
+            ++it;
+            continue;
+        }
+        
+        if (TextSnippet *snippet = snippets.value(id)) {
+            // The buffer is wiped once the template and any send let go of it too
+            snippet->textTemplate.clear();
+            snippet->text.reset();
+        }
+        forgetCachedPlan(id);
+        it = decryptedTexts.erase(it);
+    }
     
-    for (const auto& group : groups) {
-        try {
-            settings.beginGroup(group);
-            
-            QString name = settings.value("Name").toString().trimmed();
-            QString encryptedText = settings.value("Text").toString();
-            int modKeys = settings.value("ModKeys", 0).toInt();
-            int key = settings.value("Key", 0).toInt();
-            int id = settings.value("Id", -1).toInt();
-
-            // Stricter data validity check
-            if (name.isEmpty() || id < 0 || key == 0 || usedIds.contains(id)) {
-                qWarning("Skipping an invalid snippet: name='%s', id=%d, key=%d, already used=%d",
-                    qPrintable(name), id, key, usedIds.contains(id));
-                settings.endGroup();
-                continue;
-            }
-            
-            usedIds.insert(id);
-            
-            if (id >= nextHotkeyId) {
-                nextHotkeyId = id + 1;
-            }
-            
-            // Use empty string if decryption fails
-            QString decryptedText;
-            try {
-                decryptedText = decrypt(encryptedText);
-            } catch (...) {
-                decryptedText = "";
-                qWarning("Decryption error for the snippet: %s", qPrintable(name));
-            }
-            
-            TextSnippet *snippet = new TextSnippet(
-                name, decryptedText, modKeys, key, id);
-            
-            snippets[id] = snippet;
+    if (forgetTextAfter <= 0 || decryptedTexts.isEmpty()) {
+        forgetTextTimer->stop();
+    }
+}
 
-            // Add an item to the list
-            QListWidgetItem *item = new QListWidgetItem();
-            snippetList->addItem(item);
-            updateSnippetListItem(snippetList->count() - 1, snippet);
-            
-            // Try to register hotkey, but don't crash if it fails
-            try {
-                registerHotKey(snippet);
-            } catch (...) {
-                qWarning("Failed to register hotkey for snippet: %s", qPrintable(name));
-            }
-            
-            settings.endGroup();
-        } catch (const std::exception& e) {
-            qWarning("Snippet loading exception: %s", e.what());
-            settings.endGroup();
+void MainWindow::loadSnippets()
+{
+    // Clear existing snippets
+    clearSnippets();
+    forgetCachedPlan(-1);
+    decryptedTexts.clear();
+    selectedSnippetId = -1;
+    
+    textInput->setEchoMode(config->values().maskText ? QLineEdit::Password : QLineEdit::Normal);
+    
+    vaultLoading = true;
+    loadConflicts.clear();
+    listingNs = 0;
+    statusBar()->showMessage("Loading snippets...");
+    QMetaObject::invokeMethod(snippetWriter, &SnippetWriter::load);
+}
+
+void MainWindow::snippetsLoaded(const QList<VaultRecord> &records)
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    QList<TextSnippet*> listed;
+    QList<HotkeyRegistry::Binding> bindings;
+    listed.reserve(records.size());
+    bindings.reserve(records.size());
+    for (const VaultRecord &record : records) {
+        if (record.name.isEmpty()) {
+            qWarning("Skipping a snippet without a name: id=%d", record.id);
             continue;
-        } catch (...) {
-            qWarning("Unknown exception on snippet loading");
-            settings.endGroup();
+        }
+        if (record.id <= 0 || record.id > MaxSnippetId) {
+            qWarning("Skipping a snippet with an invalid id: %d", record.id);
             continue;
         }
+        
+        if (record.id >= nextHotkeyId) {
+            nextHotkeyId = record.id + 1;
+        }
+        
+        // The text is decrypted on first use
+        TextSnippet *snippet = new TextSnippet(
+            record.name, record.hotkeyModifiers, record.hotkeyKey, record.id);
+        snippet->tags = record.tags;
+        snippet->hotkeyTail = QKeySequence(record.hotkeyTail, QKeySequence::PortableText);
+        
+        insertSnippet(snippet);
+        listed.append(snippet);
+        if (snippet->hotkeyTail.isEmpty() && snippet->hotkeyKey != 0) {
+            bindings.append({ record.id, record.hotkeyModifiers, record.hotkeyKey });
+        }
     }
     
-    settings.endGroup();
+    // Register the batch in one pass; duplicates are caught before reaching the system
+    loadConflicts.append(hotkeys->bindAll(bindings));
+    for (TextSnippet *snippet : std::as_const(listed)) {
+        if (snippet->hotkeyTail.isEmpty()) {
+            snippet->hotkeyActive = hotkeys->isBound(snippet->hotkeyId);
+            continue;
+        }
+        
+        // Sequences go into the trie; only their leaders reach the system
+        HotkeyRegistry::Conflict conflict;
+        if (!registerHotKey(snippet, &conflict)) {
+            loadConflicts.append(conflict);
+        }
+    }
+    
+    // Hand the whole batch to the view at once
+    snippetModel->appendSnippets(listed);
+    listingNs += timer.nsecsElapsed();
+}
+
+void MainWindow::vaultLoaded(const QString &error)
+{
+    vaultLoading = false;
+    statusBar()->clearMessage();
+    qInfo("Startup: %lld snippets listed and bound in %.1f ms, ready after %.1f ms",
+          qlonglong(snippets.size()), listingNs / 1e6, startupTimer.nsecsElapsed() / 1e6);
+    
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "Vault error", error);
+        return;
+    }
+    
+    if (!loadConflicts.isEmpty()) {
+        qWarning("%lld snippet hotkeys could not be registered", qlonglong(loadConflicts.size()));
+        reportHotkeyConflicts(loadConflicts);
+        loadConflicts.clear();
+    }
 }
 
 void MainWindow::resetAllSettings()
 {
+    if (vaultLoading || transferWatcher->isRunning()) {
+        statusBar()->showMessage("Still loading snippets, try again in a moment.", 3000);
+        return;
+    }
+    
     QMessageBox::StandardButton reply = QMessageBox::question(this,
         "Reset all settings",
         "Are you sure you want to remove all snippets and settings? This action cannot be undone.",
@@ -794,16 +1721,24 @@ void MainWindow::resetAllSettings()
         
     if (reply == QMessageBox::Yes) {
         // Clean up current snippets
-        snippetList->clear();
-        for (auto snippet : snippets) {
-            UnregisterHotKey((HWND)winId(), snippet->hotkeyId);
-            delete snippet;
-        }
-        snippets.clear();
+        unregisterAllHotKeys();
+        clearSnippets();
+        forgetCachedPlan(-1);
+        decryptedTexts.clear();
+        unwrittenTexts.clear();
+        selectedSnippetId = -1;
         
-        // Clear settings
-        settings.clear();
-        settings.sync();
+        // Drop unsaved changes and remove the vault once queued writes are done
+        saveTimer->stop();
+        dirtySnippets.clear();
+        changedTexts.clear();
+        removedSnippets.clear();
+        VaultFile *vaultFile = vault;
+        QMetaObject::invokeMethod(snippetWriter, [vaultFile]() { vaultFile->remove(); },
+                                  Qt::BlockingQueuedConnection);
+        
+        // Clear settings; the defaults are applied through settingsChanged()
+        config->reset();
         
         // Reset nextHotkeyId
         nextHotkeyId = 1;
@@ -811,84 +1746,36 @@ void MainWindow::resetAllSettings()
         // Update UI
         nameInput->clear();
         textInput->clear();
+        tagsInput->clear();
         
         QMessageBox::information(this, "Settings reset",
             "All snippets and settings have been removed. The next time the program is started, it will be in the default state.");
     }
 }
 
-QString MainWindow::encrypt(const QString &text)
+void MainWindow::copyToClipboard(const QString &text)
 {
-    // Use a more secure encryption method with salt
-    if (text.isEmpty()) return "";
-    
-    // Generate a random salt
-    QByteArray salt = QCryptographicHash::hash(
-        QDateTime::currentDateTime().toString().toUtf8(),
-        QCryptographicHash::Md5);
-    
-    // Create a key using password-based key derivation
-    QByteArray keyMaterial = "KeyGhostSecureKey123" + salt;
-    QByteArray key = QCryptographicHash::hash(keyMaterial, QCryptographicHash::Sha256);
-    
-    // XOR with the derived key (still not truly secure, but better than before)
-    QByteArray textData = text.toUtf8();
-    QByteArray result;
+    clipboardGuard->copy(text);
     
-    for (int i = 0; i < textData.size(); i++) {
-        result.append(textData[i] ^ key[i % key.size()]);
+    // Start timer to clear clipboard if setting enabled
+    if (config->values().clearClipboard) {
+        clipboardTimer->start(config->values().clipboardClearDelay * 1000);
     }
-    
-    // Prepend the salt to the encrypted data
-    QByteArray finalResult = salt + result;
-    return finalResult.toBase64();
 }
 
-QString MainWindow::decrypt(const QString &text)
+void MainWindow::clearClipboardDelayed()
 {
-    if (text.isEmpty()) return "";
-    
-    try {
-        QByteArray data = QByteArray::fromBase64(text.toUtf8());
-        if (data.size() < 16) return ""; // Not enough data for salt + content
-        
-        // Extract salt (first 16 bytes)
-        QByteArray salt = data.left(16);
-        QByteArray encrypted = data.mid(16);
-        
-        // Recreate the key
-        QByteArray keyMaterial = "KeyGhostSecureKey123" + salt;
-        QByteArray key = QCryptographicHash::hash(keyMaterial, QCryptographicHash::Sha256);
-        
-        // Decrypt using XOR
-        QByteArray result;
-        for (int i = 0; i < encrypted.size(); i++) {
-            result.append(encrypted[i] ^ key[i % key.size()]);
-        }
-        
-        return QString::fromUtf8(result);
-    } catch (...) {
-        // Return empty string if decryption fails
-        return "";
-    }
+    // Leave it alone if the user has copied something else since
+    clipboardGuard->clearOurs();
 }
 
-void MainWindow::copyToClipboard(const QString &text)
+QString MainWindow::hotkeyToString(const TextSnippet *snippet)
 {
-    QClipboard *clipboard = QApplication::clipboard();
-    clipboard->setText(text);
-    
-    // Start timer to clear clipboard if setting enabled
-    if (settings.value("ClearClipboard", false).toBool()) {
-        int clearDelay = settings.value("ClipboardClearDelay", 30).toInt();
-        clipboardTimer->start(clearDelay * 1000);
+    QString result = hotkeyToString(snippet->hotkeyModifiers, snippet->hotkeyKey);
+    if (!snippet->hotkeyTail.isEmpty()) {
+        result += ", " + snippet->hotkeyTail.toString(QKeySequence::NativeText);
     }
-}
-
-void MainWindow::clearClipboardDelayed()
-{
-    QClipboard *clipboard = QApplication::clipboard();
-    clipboard->clear();
+    return result;
 }
 
 QString MainWindow::hotkeyToString(int modifiers, int key)
@@ -905,6 +1792,10 @@ QString MainWindow::hotkeyToString(int modifiers, int key)
     if (modifiers & MOD_WIN)
         result += "Win+";
     
+#ifndef Q_OS_WIN
+    // Keys are stored as Qt key codes outside of Windows
+    result += QKeySequence(key).toString(QKeySequence::NativeText);
+#else
     // Add a main key
     // Special keys
     switch (key) {
@@ -954,15 +1845,52 @@ QString MainWindow::hotkeyToString(int modifiers, int key)
             }
             break;
     }
+#endif
     
     return result;
 }
 
-void MainWindow::updateSnippetListItem(int index, TextSnippet* snippet)
+int MainWindow::currentSnippetRow() const
 {
-    if (!snippet || index < 0 || index >= snippetList->count()) return;
-    
-    QString hotkeyString = hotkeyToString(snippet->hotkeyModifiers, snippet->hotkeyKey);
-    QString displayText = QString("%1 [%2]").arg(snippet->name, hotkeyString);
-    snippetList->item(index)->setText(displayText);
+    return snippetList->currentIndex().row();
+}
+
+TextSnippet *MainWindow::snippetAt(int row) const
+{
+    return snippetModel->snippetAt(row);
+}
+
+void MainWindow::insertSnippet(TextSnippet *snippet)
+{
+    snippets.insert(snippet->hotkeyId, snippet);
+    snippetIdsByName.insert(snippet->name, snippet->hotkeyId);
+    searchIndex->insert(snippet->hotkeyId, snippet->name, snippet->tags);
+}
+
+void MainWindow::renameSnippet(TextSnippet *snippet, const QString &name)
+{
+    // Also called after tag changes so the search index picks them up
+    snippetIdsByName.remove(snippet->name, snippet->hotkeyId);
+    snippet->name = name;
+    snippetIdsByName.insert(name, snippet->hotkeyId);
+    searchIndex->insert(snippet->hotkeyId, snippet->name, snippet->tags);
+}
+
+void MainWindow::removeSnippet(int id)
+{
+    TextSnippet *snippet = snippets.take(id);
+    if (!snippet) return;
+    snippetModel->removeSnippet(id);
+    snippetIdsByName.remove(snippet->name, id);
+    searchIndex->remove(id);
+    delete snippet;
+}
+
+void MainWindow::clearSnippets()
+{
+    snippetModel->clear();
+    qDeleteAll(snippets);
+    snippets.clear();
+    snippetIdsByName.clear();
+    searchIndex->clear();
 }
@@ -8,15 +8,35 @@
 #include <QLabel>
 #include <QSystemTrayIcon>
 #include <QMenu>
-#include <Windows.h>
-#include <QListWidget>
-#include <QSettings>
-#include <QMap>
+#include <QListView>
+#include <QHash>
+#include <QSet>
 #include <QTimer>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QKeySequence>
+#include "hotkeyregistry.h"
+#include "snippettemplate.h"
+#include "snippettransfer.h"
 
 // New snippet class forward declaration
 class TextSnippet;
 class SettingsDialog;
+class InjectionWorker;
+class VaultCrypto;
+class SnippetWriter;
+class VaultFile;
+struct VaultRecord;
+class SnippetListModel;
+class TrigramIndex;
+class QuickPalette;
+class ChordDispatcher;
+class ForegroundWatcher;
+class ClipboardGuard;
+class AppConfig;
+class QProgressDialog;
+class CommandServer;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -29,13 +49,17 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+    
+    static QString hotkeyToString(int modifiers, int key);
+    static QString hotkeyToString(const TextSnippet *snippet); // Including a sequence tail
 
 protected:
     void closeEvent(QCloseEvent *event) override;
     bool nativeEvent(const QByteArray &eventType, void *message, qintptr *result) override;
 
 private slots:
-    void sendKeystroke(int snippetId = -1);
+    void sendKeystroke(int snippetId = -1);     // Waits for the target window to be picked
+    void fireSnippet(int snippetId);            // Hotkeys: types into the focused window right away
     void minimizeToTray();
     void restoreFromTray(QSystemTrayIcon::ActivationReason reason);
     void addNewSnippet();
@@ -47,47 +71,147 @@ private slots:
     void loadSnippets();
     void clearClipboardDelayed();
     void resetAllSettings(); // Новый метод для сброса настроек
+    void stopTyping();
+    void typingProgress(int job, int typed, int total);
+    void typingFinished(int job, bool completed);
+    void typingPaced(int job, double charsPerSecond, double jitterUs, double maxLateUs);
+    void showQuickPalette();
+    void importSnippets();
+    void exportSnippets();
+    void rotateKey();
 
 private:
     Ui::MainWindow *ui;
     QLineEdit *nameInput;
     QLineEdit *textInput;
-    QListWidget *snippetList;
+    QLineEdit *tagsInput;
+    QListView *snippetList;
+    SnippetListModel *snippetModel;
     QSystemTrayIcon *trayIcon;
-    QMap<int, TextSnippet*> snippets;
-    QSettings settings;
+    QHash<int, TextSnippet*> snippets;          // by id
+    QMultiHash<QString, int> snippetIdsByName;  // names aren't unique
+    HotkeyRegistry *hotkeys;
+    ChordDispatcher *chords;                    // Sequences behind shared leader hotkeys
+    TrigramIndex *searchIndex;                  // names and tags, for the quick palette
+    QuickPalette *quickPalette;
+    AppConfig *config;                          // Settings, read once and saved in the background
     SettingsDialog *settingsDialog;
     QTimer *clipboardTimer;
+    ClipboardGuard *clipboardGuard;             // Tags our text, stashes the user's around pastes
+    CommandServer *commandServer;               // keyghost --type from scripts and launchers
+    QThread *injectionThread;
+    InjectionWorker *injectionWorker;
+    QLabel *typingStatusLabel;
+    QPushButton *stopTypingButton;
+    QAction *stopTypingAction;
+    int typingJob;
+    int lastTypingJob;
+    int typingSnippetId;
+    int pasteJob;                               // typingJob when it pastes instead of typing
+    
+    // Tray, palette and Test sends wait for the user to switch to the target window
+    ForegroundWatcher *foregroundWatcher;
+    QTimer *targetTimeout;
+    SnippetTemplate targetText;
+    int targetSnippetId;
+    VaultCrypto *vaultCrypto;
+    VaultFile *vault;
+    
+    // Write-behind persistence: changed ids are collected and flushed after a short debounce
+    QThread *writerThread;
+    SnippetWriter *snippetWriter;
+    QTimer *saveTimer;
+    QSet<int> dirtySnippets;
+    QSet<int> changedTexts;
+    QSet<int> removedSnippets;
+    int writeGeneration;
+    int writtenGeneration;
+    QHash<int, int> unwrittenTexts; // id -> generation that stores the text
+    
+    // The vault is read on the writer thread after the window is up; its
+    // records are listed and their hotkeys registered batch by batch
+    bool vaultLoading;
+    QList<HotkeyRegistry::Conflict> loadConflicts;
+    QElapsedTimer startupTimer;
+    qint64 listingNs;
+    
+    // Bulk import, export and key rotation run on the thread pool, one at a time
+    enum TransferKind { ImportTransfer, ExportTransfer, RotateTransfer };
+    QFutureWatcher<TransferResult> *transferWatcher;
+    QProgressDialog *transferProgress;
+    TransferKind transferKind;
+    qsizetype transferCount;
+    
+    // While the vault is resealed under a new data key, edits are held back
+    // so the swapped-in vault can't miss them
+    bool rotatingKey;
+    VaultCrypto *pendingCrypto;
+    QByteArray pendingWrappedKey;
+    
+    // Texts stay encrypted until needed and are wiped again after ForgetTextAfter seconds idle
+    QHash<int, qint64> decryptedTexts; // id -> last use
+    QTimer *forgetTextTimer;
+    int selectedSnippetId;
     
     int nextHotkeyId;
-    bool maskText;
-    int typingDelay;
-    bool autoClear;
 
-    void sendText(const QString &text);
+    void sendText(const SecretText &text, int snippetId, int caretBack = 0, bool afterHotkey = false);
+    QString typeRequested(const QString &target);
+    void settingsChanged();
+    void startTransfer(const QFuture<TransferResult> &future, const QString &label, TransferKind kind);
+    void transferFinished();
+    void finishKeyRotation(const TransferResult &result, bool resealed);
+    void addImportedSnippets(const TransferResult &result);
+    bool snippetTemplate(int snippetId, SnippetTemplate &compiled);
+    void targetWindowActivated();
+    void cancelTargetWait(const QString &message);
+    void snippetSent(int snippetId);
+    void forgetCachedPlan(int snippetId);
+    void markSnippetDirty(int id, bool textChanged = false);
+    void markSnippetRemoved(int id);
+    void flushSnippets(bool wait);
+    void snippetsWritten(int generation);
+    void snippetsLoaded(const QList<VaultRecord> &records);
+    void vaultLoaded(const QString &error);
+    void touchSnippetText(int id);
+    bool decryptSnippetText(TextSnippet *snippet);
+    void forgetIdleTexts();
     void createTrayIcon();
-    void registerHotKey(TextSnippet *snippet);
+    bool registerHotKey(TextSnippet *snippet, HotkeyRegistry::Conflict *conflict = nullptr);
+    void unregisterHotKey(TextSnippet *snippet);
     void unregisterAllHotKeys();
+    bool registerPaletteHotKey(HotkeyRegistry::Conflict *conflict = nullptr);
+    void reportHotkeyConflicts(const QList<HotkeyRegistry::Conflict> &conflicts);
     void setupUi();
     void createActions();
-    QString encrypt(const QString &text);
-    QString decrypt(const QString &text);
     void copyToClipboard(const QString &text);
-    QString hotkeyToString(int modifiers, int key); // Новая функция для преобразования кодов в текст
-    void updateSnippetListItem(int index, TextSnippet* snippet); // Новая функция для обновления элемента списка
+    int currentSnippetRow() const;
+    TextSnippet *snippetAt(int row) const;
+    void insertSnippet(TextSnippet *snippet);
+    void renameSnippet(TextSnippet *snippet, const QString &name);
+    void removeSnippet(int id);
+    void clearSnippets(); // Empties the list, the lookups and the search index, deleting every snippet
 };
 
 // New class to represent a text snippet
 class TextSnippet {
 public:
     QString name;
-    QString text;
+    SecretText text;                // Plaintext in secure memory, null until decrypted
+    SnippetTemplate textTemplate;   // text parsed into placeholders, kept with the text
     int hotkeyModifiers;
     int hotkeyKey;
     int hotkeyId;
+    QStringList tags;
+    QKeySequence hotkeyTail;    // Keys pressed after the hotkey, empty for a single chord
+    bool hotkeyActive = false;  // Registered; false when the chord clashed
+    
+    TextSnippet(const QString &name, int modifiers, int key, int id)
+        : name(name), hotkeyModifiers(modifiers), hotkeyKey(key), hotkeyId(id) {}
     
-    TextSnippet(const QString &name, const QString &text, int modifiers, int key, int id)
-        : name(name), text(text), hotkeyModifiers(modifiers), hotkeyKey(key), hotkeyId(id) {}
+    // View of the secure buffer for comparisons; widgets need a toString() copy,
+    // since the buffer is wiped when the text is forgotten
+    QStringView textView() const { return text ? text->text() : QStringView(); }
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,168 @@
+#include "pacer.h"
+#include <cmath>
+
+#if defined(Q_OS_WIN)
+#include <Windows.h>
+#elif defined(Q_OS_LINUX)
+#include <cerrno>
+#include <ctime>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// The timer is set to wake this much early and the rest is spun, since even
+// a high-resolution timer may oversleep by a few hundred microseconds
+const qint64 HighResolutionSpinNs = 250000;
+const qint64 TimerTickSpinNs = 16000000;
+#endif
+
+} // namespace
+
+Pacer::Pacer()
+    : deadline(0)
+    , waits(0)
+    , lateMean(0)
+    , lateM2(0)
+    , maxLate(0)
+    , timer(nullptr)
+    , highResolution(false)
+{
+#ifdef Q_OS_WIN
+    timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    highResolution = timer != nullptr;
+    if (!timer) {
+        // Before Windows 10 1803 only timer-tick resolution is available
+        timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+    if (!timer) {
+        qWarning("Failed to create a waitable timer, error %lu", GetLastError());
+    }
+#endif
+}
+
+Pacer::~Pacer()
+{
+#ifdef Q_OS_WIN
+    if (timer) {
+        CloseHandle(HANDLE(timer));
+    }
+#endif
+}
+
+void Pacer::begin()
+{
+    deadline = nowNs();
+    waits = 0;
+    lateMean = 0;
+    lateM2 = 0;
+    maxLate = 0;
+}
+
+bool Pacer::wait(qint64 intervalUs, const std::function<bool()> &cancelled)
+{
+    if (intervalUs <= 0) return true;
+
+    const qint64 interval = intervalUs * 1000;
+    deadline += interval;
+
+    qint64 now = nowNs();
+    if (now - deadline > interval) {
+        // Stalled for more than a whole interval (blocked input, a slow
+        // reader): carry on from here instead of rushing the missed deadlines
+        deadline = now;
+        return true;
+    }
+    if (cancelled) {
+        // Slices short enough for a stop to take effect within CancelPollNs
+        while (deadline - now > CancelPollNs) {
+            sleepUntil(now + CancelPollNs, false);
+            if (cancelled()) {
+                return false;
+            }
+            now = nowNs();
+        }
+    }
+    if (now < deadline) {
+        sleepUntil(deadline);
+        now = nowNs();
+    }
+
+    const double late = double(now - deadline);
+    waits++;
+    const double delta = late - lateMean;
+    lateMean += delta / waits;
+    lateM2 += delta * (late - lateMean);
+    maxLate = qMax(maxLate, now - deadline);
+    return true;
+}
+
+PacingStats Pacer::stats() const
+{
+    PacingStats result;
+    result.waits = waits;
+    result.lateUs = lateMean / 1000.0;
+    result.jitterUs = waits > 1 ? std::sqrt(lateM2 / (waits - 1)) / 1000.0 : 0.0;
+    result.maxLateUs = double(maxLate) / 1000.0;
+    return result;
+}
+
+qint64 Pacer::nowNs()
+{
+#if defined(Q_OS_WIN)
+    static const qint64 frequency = []() {
+        LARGE_INTEGER value;
+        QueryPerformanceFrequency(&value);
+        return qint64(value.QuadPart);
+    }();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // Split so the multiplication can't overflow on long uptimes
+    const qint64 ticks = counter.QuadPart;
+    return ticks / frequency * 1000000000 + ticks % frequency * 1000000000 / frequency;
+#elif defined(Q_OS_LINUX)
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void Pacer::sleepUntil(qint64 deadlineNs, bool precise)
+{
+#if defined(Q_OS_WIN)
+    const qint64 spin = !precise ? 0 : highResolution ? HighResolutionSpinNs : TimerTickSpinNs;
+    const qint64 remaining = deadlineNs - nowNs() - spin;
+    if (timer && remaining > 0) {
+        LARGE_INTEGER due;
+        due.QuadPart = -(remaining / 100);   // Relative, in 100 ns units
+        if (SetWaitableTimer(HANDLE(timer), &due, 0, nullptr, nullptr, FALSE)) {
+            WaitForSingleObject(HANDLE(timer), INFINITE);
+        }
+    }
+    while (precise && nowNs() < deadlineNs) {
+        YieldProcessor();
+    }
+#elif defined(Q_OS_LINUX)
+    Q_UNUSED(precise);
+    // Absolute, so a signal interrupting the sleep doesn't stretch it
+    timespec until;
+    until.tv_sec = time_t(deadlineNs / 1000000000);
+    until.tv_nsec = long(deadlineNs % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) == EINTR) {
+    }
+#else
+    Q_UNUSED(precise);
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(deadlineNs))));
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <QtGlobal>
+#include <functional>
+
+// How closely the pauses of one send kept to their deadlines
+struct PacingStats
+{
+    int waits = 0;          // Pauses taken
+    double lateUs = 0;      // Mean wakeup lateness
+    double jitterUs = 0;    // Standard deviation of the lateness
+    double maxLateUs = 0;
+};
+
+// Spaces submissions with sub-millisecond precision. Deadlines are absolute
+// and follow on from each other, so the time spent submitting is part of the
+// interval rather than added to it and late wakeups don't accumulate. Sleeps
+// on a high-resolution waitable timer on Windows and with clock_nanosleep on
+// Linux, instead of QThread::msleep and its ~15.6 ms granularity on Windows.
+class Pacer
+{
+public:
+    Pacer();
+    ~Pacer();
+
+    // Starts a send; the first deadline is counted from now
+    void begin();
+
+    // Sleeps until intervalUs after the previous deadline. A long sleep polls
+    // cancelled every CancelPollNs and returns false as soon as it is true.
+    bool wait(qint64 intervalUs, const std::function<bool()> &cancelled = std::function<bool()>());
+
+    static const qint64 CancelPollNs = 20000000;
+
+    // Measured since begin()
+    PacingStats stats() const;
+
+    // Monotonic clock the deadlines are kept on
+    static qint64 nowNs();
+
+private:
+    Q_DISABLE_COPY(Pacer)
+
+    // precise spins out the last stretch; the slices of a polled wait don't need it
+    void sleepUntil(qint64 deadlineNs, bool precise = true);
+
+    qint64 deadline;
+    int waits;
+    double lateMean;        // Running mean and sum of squares (Welford)
+    double lateM2;
+    qint64 maxLate;
+    void *timer;            // Waitable timer HANDLE on Windows
+    bool highResolution;    // Timer wakes within ~0.5 ms, otherwise within a timer tick
+};
+
+#endif // PACER_H
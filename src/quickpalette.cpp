@@ -0,0 +1,118 @@
+#include "quickpalette.h"
+#include "trigramindex.h"
+#include "snippetlistmodel.h"
+#include <QVBoxLayout>
+#include <QKeyEvent>
+#include <QCursor>
+#include <QGuiApplication>
+#include <QScreen>
+
+QuickPalette::QuickPalette(const TrigramIndex *index, const SnippetListModel *model, QWidget *parent)
+    : QWidget(parent, Qt::Tool | Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint)
+    , index(index)
+    , model(model)
+{
+    setWindowTitle("KeyGhost Quick Launch");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 6, 6, 6);
+
+    queryInput = new QLineEdit(this);
+    queryInput->setPlaceholderText("Type to search snippets...");
+    queryInput->setClearButtonEnabled(true);
+    queryInput->installEventFilter(this);
+
+    resultList = new QListWidget(this);
+    resultList->setUniformItemSizes(true);
+    resultList->setFocusPolicy(Qt::NoFocus);
+
+    layout->addWidget(queryInput);
+    layout->addWidget(resultList);
+
+    connect(queryInput, &QLineEdit::textChanged, this, &QuickPalette::updateResults);
+    connect(queryInput, &QLineEdit::returnPressed, this, &QuickPalette::chooseCurrent);
+    connect(resultList, &QListWidget::itemActivated, this, &QuickPalette::chooseCurrent);
+
+    resize(420, 320);
+}
+
+void QuickPalette::popup()
+{
+    queryInput->clear();
+    resultList->clear();
+
+    // Center on the screen the user is working on
+    QScreen *screen = QGuiApplication::screenAt(QCursor::pos());
+    if (!screen) screen = QGuiApplication::primaryScreen();
+    QRect area = screen->availableGeometry();
+    move(area.center().x() - width() / 2, area.top() + area.height() / 4);
+
+    show();
+    raise();
+    activateWindow();
+    queryInput->setFocus();
+}
+
+bool QuickPalette::eventFilter(QObject *watched, QEvent *event)
+{
+    // Keep typing in the line edit while the arrows move through the results
+    if (watched == queryInput && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        int row = resultList->currentRow();
+        switch (keyEvent->key()) {
+        case Qt::Key_Down:
+            resultList->setCurrentRow(qMin(row + 1, resultList->count() - 1));
+            return true;
+        case Qt::Key_Up:
+            resultList->setCurrentRow(qMax(row - 1, 0));
+            return true;
+        case Qt::Key_PageDown:
+        case Qt::Key_PageUp:
+            QCoreApplication::sendEvent(resultList, event);
+            return true;
+        case Qt::Key_Escape:
+            hide();
+            return true;
+        default:
+            break;
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+bool QuickPalette::event(QEvent *event)
+{
+    // Behave like a popup: clicking elsewhere dismisses it
+    if (event->type() == QEvent::WindowDeactivate) {
+        hide();
+    }
+    return QWidget::event(event);
+}
+
+void QuickPalette::updateResults(const QString &query)
+{
+    resultList->clear();
+
+    const QList<TrigramIndex::Match> matches = index->search(query, ResultLimit);
+    for (const TrigramIndex::Match &match : matches) {
+        int row = model->rowOf(match.id);
+        if (row < 0) continue;
+
+        QListWidgetItem *item = new QListWidgetItem(model->data(model->index(row)).toString(), resultList);
+        item->setData(Qt::UserRole, match.id);
+    }
+
+    if (resultList->count() > 0) {
+        resultList->setCurrentRow(0);
+    }
+}
+
+void QuickPalette::chooseCurrent()
+{
+    QListWidgetItem *item = resultList->currentItem();
+    if (!item) return;
+
+    int id = item->data(Qt::UserRole).toInt();
+    hide();
+    emit snippetChosen(id);
+}
@@ -0,0 +1,42 @@
+#ifndef QUICKPALETTE_H
+#define QUICKPALETTE_H
+
+#include <QWidget>
+#include <QLineEdit>
+#include <QListWidget>
+
+class TrigramIndex;
+class SnippetListModel;
+
+// Small search window opened by the global palette hotkey. Typing ranks
+// snippets through the trigram index; Enter picks the highlighted one.
+class QuickPalette : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static const int ResultLimit = 50;
+
+    QuickPalette(const TrigramIndex *index, const SnippetListModel *model, QWidget *parent = nullptr);
+
+    // Clears the query and shows the palette on the screen under the cursor
+    void popup();
+
+signals:
+    void snippetChosen(int id);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    bool event(QEvent *event) override;
+
+private:
+    void updateResults(const QString &query);
+    void chooseCurrent();
+
+    const TrigramIndex *index;
+    const SnippetListModel *model;
+    QLineEdit *queryInput;
+    QListWidget *resultList;
+};
+
+#endif // QUICKPALETTE_H
@@ -0,0 +1,218 @@
+#include "securememory.h"
+#include <openssl/crypto.h>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <sys/mman.h>
+#endif
+
+SecureArena &SecureArena::instance()
+{
+    static SecureArena arena;
+    return arena;
+}
+
+int SecureArena::sizeClass(std::size_t size)
+{
+    int index = 0;
+    std::size_t classSize = 16;
+    while (classSize < size) {
+        classSize <<= 1;
+        index++;
+    }
+    return index;
+}
+
+void *SecureArena::allocate(std::size_t size)
+{
+    if (size == 0) size = 1;
+
+    QMutexLocker locker(&mutex);
+    if (size > MaxClassSize) {
+        return mapLocked(size);
+    }
+
+    const int index = sizeClass(size);
+    if (void *block = freeLists[index]) {
+        // Only the link was written since the block was wiped
+        std::memcpy(&freeLists[index], block, sizeof(void*));
+        std::memset(block, 0, sizeof(void*));
+        return block;
+    }
+
+    const std::size_t classSize = std::size_t(16) << index;
+    if (chunkUsed + classSize > ChunkSize) {
+        chunk = static_cast<char*>(mapLocked(ChunkSize));
+        if (!chunk) {
+            chunkUsed = ChunkSize;
+            return nullptr;
+        }
+        chunkUsed = 0;
+    }
+    void *block = chunk + chunkUsed;
+    chunkUsed += classSize;
+    return block;
+}
+
+void SecureArena::release(void *block, std::size_t size)
+{
+    if (!block) return;
+    if (size == 0) size = 1;
+
+    wipe(block, size);
+
+    QMutexLocker locker(&mutex);
+    if (size > MaxClassSize) {
+        unmap(block, size);
+        return;
+    }
+
+    const int index = sizeClass(size);
+    std::memcpy(block, &freeLists[index], sizeof(void*));
+    freeLists[index] = block;
+}
+
+void SecureArena::wipe(void *data, std::size_t size)
+{
+    if (data && size > 0) {
+        OPENSSL_cleanse(data, size);
+    }
+}
+
+void *SecureArena::mapLocked(std::size_t size)
+{
+#ifdef Q_OS_WIN
+    void *pages = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!pages) {
+        return nullptr;
+    }
+    bool locked = VirtualLock(pages, size);
+    if (!locked) {
+        // Locked pages count against the minimum working set, grow it and retry
+        SIZE_T minimum = 0;
+        SIZE_T maximum = 0;
+        HANDLE process = GetCurrentProcess();
+        if (GetProcessWorkingSetSize(process, &minimum, &maximum)
+            && SetProcessWorkingSetSize(process, minimum + size + ChunkSize, qMax(maximum, minimum + size + ChunkSize))) {
+            locked = VirtualLock(pages, size);
+        }
+    }
+    if (!locked && !lockWarned) {
+        qWarning("Failed to lock secure memory, error %lu; plaintext may be swapped", GetLastError());
+        lockWarned = true;
+    }
+#else
+    void *pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED) {
+        return nullptr;
+    }
+    if (mlock(pages, size) != 0 && !lockWarned) {
+        qWarning("Failed to lock secure memory: %s; plaintext may be swapped", strerror(errno));
+        lockWarned = true;
+    }
+#ifdef MADV_DONTDUMP
+    madvise(pages, size, MADV_DONTDUMP);
+#endif
+#endif
+    return pages;
+}
+
+void SecureArena::unmap(void *pages, std::size_t size)
+{
+#ifdef Q_OS_WIN
+    VirtualUnlock(pages, size);
+    VirtualFree(pages, 0, MEM_RELEASE);
+#else
+    munlock(pages, size);
+    munmap(pages, size);
+#endif
+}
+
+SecretBuffer::SecretBuffer(qsizetype size)
+{
+    if (size <= 0) return;
+
+    bytes = static_cast<char*>(SecureArena::instance().allocate(std::size_t(size)));
+    if (!bytes) {
+        qWarning("Out of secure memory for %lld bytes", qlonglong(size));
+        return;
+    }
+    used = size;
+    capacity = size;
+}
+
+SecretBuffer::~SecretBuffer()
+{
+    clear();
+}
+
+SecretBuffer::SecretBuffer(SecretBuffer &&other) noexcept
+    : bytes(other.bytes)
+    , used(other.used)
+    , capacity(other.capacity)
+{
+    other.bytes = nullptr;
+    other.used = 0;
+    other.capacity = 0;
+}
+
+SecretBuffer &SecretBuffer::operator=(SecretBuffer &&other) noexcept
+{
+    if (this != &other) {
+        clear();
+        std::swap(bytes, other.bytes);
+        std::swap(used, other.used);
+        std::swap(capacity, other.capacity);
+    }
+    return *this;
+}
+
+void SecretBuffer::truncate(qsizetype size)
+{
+    if (size < 0 || size >= used) return;
+
+    SecureArena::wipe(bytes + size, std::size_t(used - size));
+    used = size;
+}
+
+void SecretBuffer::clear()
+{
+    // The arena wipes the whole block, not just the used part
+    SecureArena::instance().release(bytes, std::size_t(capacity));
+    bytes = nullptr;
+    used = 0;
+    capacity = 0;
+}
+
+bool SecretBuffer::operator==(const SecretBuffer &other) const
+{
+    return used == other.used && (used == 0 || std::memcmp(bytes, other.bytes, std::size_t(used)) == 0);
+}
+
+SecretText SecretBuffer::share(QStringView text)
+{
+    SecretBuffer buffer(text.size() * qsizetype(sizeof(char16_t)));
+    if (!buffer.isEmpty()) {
+        std::memcpy(buffer.data(), text.utf16(), std::size_t(buffer.size()));
+    }
+    return share(std::move(buffer));
+}
+
+SecretText SecretBuffer::share(SecretBuffer &&buffer)
+{
+    return SecretText(new SecretBuffer(std::move(buffer)));
+}
+
+QStringView SecretBuffer::text() const
+{
+    return QStringView(reinterpret_cast<const char16_t*>(bytes), used / qsizetype(sizeof(char16_t)));
+}
+
+QString SecretBuffer::rawText() const
+{
+    if (!bytes) return QString();
+    return QString::fromRawData(reinterpret_cast<const QChar*>(bytes), used / qsizetype(sizeof(char16_t)));
+}
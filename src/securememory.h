@@ -0,0 +1,124 @@
+#ifndef SECUREMEMORY_H
+#define SECUREMEMORY_H
+
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringView>
+#include <cstddef>
+#include <new>
+
+// Memory for snippet plaintext: pages are locked into RAM so they're never
+// written to swap, kept out of core dumps, and every block is zeroed when
+// it's released. Small blocks come from 64 KiB chunks in power-of-two size
+// classes, large ones get pages of their own. Thread-safe.
+class SecureArena
+{
+public:
+    static SecureArena &instance();
+
+    // Zero-filled block of at least size bytes, nullptr if out of memory
+    void *allocate(std::size_t size);
+
+    // Wipes the size bytes of a block from allocate() and takes it back
+    void release(void *block, std::size_t size);
+
+    // Zeroes memory in a way the compiler can't optimize out
+    static void wipe(void *data, std::size_t size);
+
+private:
+    SecureArena() = default;
+    Q_DISABLE_COPY(SecureArena)
+
+    static const std::size_t ChunkSize = 64 * 1024;
+    static const std::size_t MaxClassSize = ChunkSize / 2;
+    static const int ClassCount = 12;   // 16 bytes to 32 KiB
+
+    static int sizeClass(std::size_t size);
+    void *mapLocked(std::size_t size);
+    static void unmap(void *pages, std::size_t size);
+
+    QMutex mutex;
+    void *freeLists[ClassCount] = {};   // Released blocks, linked through their first bytes
+    char *chunk = nullptr;
+    std::size_t chunkUsed = ChunkSize;
+    bool lockWarned = false;
+};
+
+// Standard allocator on the secure arena, for containers holding text-derived data
+template <typename T>
+class SecureAllocator
+{
+public:
+    using value_type = T;
+
+    SecureAllocator() = default;
+    template <typename U>
+    SecureAllocator(const SecureAllocator<U> &) {}
+
+    T *allocate(std::size_t count)
+    {
+        void *block = SecureArena::instance().allocate(count * sizeof(T));
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(block);
+    }
+
+    void deallocate(T *block, std::size_t count)
+    {
+        SecureArena::instance().release(block, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const SecureAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const SecureAllocator<U> &) const { return false; }
+};
+
+class SecretBuffer;
+
+// Plaintext shared between the snippet, its template and the sends in
+// flight without copying; wiped when the last reference goes
+using SecretText = QSharedPointer<const SecretBuffer>;
+
+// Move-only bytes on the secure arena
+class SecretBuffer
+{
+public:
+    SecretBuffer() = default;
+    // Zero-filled; stays empty if the arena is out of memory
+    explicit SecretBuffer(qsizetype size);
+    ~SecretBuffer();
+
+    SecretBuffer(SecretBuffer &&other) noexcept;
+    SecretBuffer &operator=(SecretBuffer &&other) noexcept;
+    SecretBuffer(const SecretBuffer &) = delete;
+    SecretBuffer &operator=(const SecretBuffer &) = delete;
+
+    char *data() { return bytes; }
+    const char *constData() const { return bytes; }
+    qsizetype size() const { return used; }
+    bool isEmpty() const { return used == 0; }
+
+    // Shrinks to size bytes, wiping the rest
+    void truncate(qsizetype size);
+    // Wipes and releases the bytes
+    void clear();
+
+    bool operator==(const SecretBuffer &other) const;
+
+    // Text buffers hold UTF-16
+    static SecretText share(QStringView text);
+    static SecretText share(SecretBuffer &&buffer);
+    QStringView text() const;
+    // QString over the buffer itself, only valid while the buffer lives
+    QString rawText() const;
+
+private:
+    char *bytes = nullptr;
+    qsizetype used = 0;
+    qsizetype capacity = 0;
+};
+
+#endif // SECUREMEMORY_H
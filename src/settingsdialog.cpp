@@ -1,12 +1,14 @@
 #include "settingsdialog.h"
+#include "appconfig.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
 #include <QLabel>
 #include <QPushButton>
 
-SettingsDialog::SettingsDialog(QWidget *parent)
+SettingsDialog::SettingsDialog(AppConfig *config, QWidget *parent)
     : QDialog(parent)
+    , config(config)
 {
     setWindowTitle("KeyGhost Settings");
     
@@ -19,8 +21,18 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     maskTextCheck = new QCheckBox("Mask text input (for passwords)", this);
     autoClearCheck = new QCheckBox("Auto-clear text after typing (for sensitive data)", this);
     
+    // Decrypted texts are wiped from memory after they haven't been used for a while
+    QHBoxLayout *forgetTextLayout = new QHBoxLayout();
+    QLabel *forgetTextLabel = new QLabel("Forget decrypted text after (seconds):", this);
+    forgetTextBox = new QSpinBox(this);
+    forgetTextBox->setRange(0, 3600);
+    forgetTextBox->setSpecialValueText("Never");
+    forgetTextLayout->addWidget(forgetTextLabel);
+    forgetTextLayout->addWidget(forgetTextBox);
+    
     securityLayout->addWidget(maskTextCheck);
     securityLayout->addWidget(autoClearCheck);
+    securityLayout->addLayout(forgetTextLayout);
     
     // Typing settings group
     QGroupBox *typingGroup = new QGroupBox("Typing", this);
@@ -28,15 +40,57 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     
     QHBoxLayout *delayLayout = new QHBoxLayout();
     QLabel *delayLabel = new QLabel("Delay between keystrokes (ms):", this);
-    typingDelayBox = new QSpinBox(this);
+    // Keystrokes are paced to the microsecond, so fractions of a millisecond count
+    typingDelayBox = new QDoubleSpinBox(this);
     typingDelayBox->setRange(0, 500);
+    typingDelayBox->setDecimals(3);
+    typingDelayBox->setSingleStep(0.1);
     delayLayout->addWidget(delayLabel);
     delayLayout->addWidget(typingDelayBox);
     
-    useClipboardCheck = new QCheckBox("Use clipboard instead of typing simulation", this);
+    // How a snippet reaches the target window; the data is the stored "Delivery" value
+    QHBoxLayout *deliveryLayout = new QHBoxLayout();
+    QLabel *deliveryLabel = new QLabel("Deliver snippets by:", this);
+    deliveryBox = new QComboBox(this);
+    deliveryBox->addItem("Typing, or pasting long ones", "Auto");
+    deliveryBox->addItem("Typing", "Type");
+    deliveryBox->addItem("Pasting (clipboard is restored)", "Paste");
+    deliveryBox->addItem("Copying to the clipboard only", "Copy");
+    deliveryLayout->addWidget(deliveryLabel);
+    deliveryLayout->addWidget(deliveryBox);
+    
+    QHBoxLayout *pasteThresholdLayout = new QHBoxLayout();
+    QLabel *pasteThresholdLabel = new QLabel("Paste snippets from (characters):", this);
+    pasteThresholdBox = new QSpinBox(this);
+    pasteThresholdBox->setRange(1, 1000000);
+    pasteThresholdLayout->addWidget(pasteThresholdLabel);
+    pasteThresholdLayout->addWidget(pasteThresholdBox);
+    
+    // Burst mode sends the text in chunks instead of one character at a time
+    burstModeCheck = new QCheckBox("Burst mode (send text in chunks)", this);
+    
+    QHBoxLayout *chunkSizeLayout = new QHBoxLayout();
+    QLabel *chunkSizeLabel = new QLabel("Characters per chunk:", this);
+    burstChunkSizeBox = new QSpinBox(this);
+    burstChunkSizeBox->setRange(0, 100000);
+    burstChunkSizeBox->setSpecialValueText("Whole text");
+    chunkSizeLayout->addWidget(chunkSizeLabel);
+    chunkSizeLayout->addWidget(burstChunkSizeBox);
+    
+    QHBoxLayout *chunkDelayLayout = new QHBoxLayout();
+    QLabel *chunkDelayLabel = new QLabel("Delay between chunks (ms):", this);
+    burstChunkDelayBox = new QDoubleSpinBox(this);
+    burstChunkDelayBox->setRange(0, 1000);
+    burstChunkDelayBox->setDecimals(3);
+    chunkDelayLayout->addWidget(chunkDelayLabel);
+    chunkDelayLayout->addWidget(burstChunkDelayBox);
     
     typingLayout->addLayout(delayLayout);
-    typingLayout->addWidget(useClipboardCheck);
+    typingLayout->addLayout(deliveryLayout);
+    typingLayout->addLayout(pasteThresholdLayout);
+    typingLayout->addWidget(burstModeCheck);
+    typingLayout->addLayout(chunkSizeLayout);
+    typingLayout->addLayout(chunkDelayLayout);
     
     // Clipboard settings group
     QGroupBox *clipboardGroup = new QGroupBox("Clipboard", this);
@@ -54,6 +108,31 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     clipboardLayout->addWidget(clearClipboardCheck);
     clipboardLayout->addLayout(clipboardDelayLayout);
     
+    // Hotkey settings group
+    QGroupBox *paletteGroup = new QGroupBox("Hotkeys", this);
+    QVBoxLayout *hotkeysLayout = new QVBoxLayout(paletteGroup);
+    
+    QHBoxLayout *paletteLayout = new QHBoxLayout();
+    QLabel *paletteLabel = new QLabel("Search palette hotkey:", this);
+    paletteHotkeyEdit = new QKeySequenceEdit(this);
+    paletteLayout->addWidget(paletteLabel);
+    paletteLayout->addWidget(paletteHotkeyEdit);
+    
+    // How long a hotkey sequence waits for its next key
+    QHBoxLayout *sequenceTimeoutLayout = new QHBoxLayout();
+    QLabel *sequenceTimeoutLabel = new QLabel("Hotkey sequence timeout (ms):", this);
+    sequenceTimeoutBox = new QSpinBox(this);
+    sequenceTimeoutBox->setRange(200, 5000);
+    sequenceTimeoutLayout->addWidget(sequenceTimeoutLabel);
+    sequenceTimeoutLayout->addWidget(sequenceTimeoutBox);
+    
+    // Hotkeys type into the window that has focus instead of asking for a target first
+    directFireCheck = new QCheckBox("Type immediately when a hotkey is pressed", this);
+    
+    hotkeysLayout->addWidget(directFireCheck);
+    hotkeysLayout->addLayout(paletteLayout);
+    hotkeysLayout->addLayout(sequenceTimeoutLayout);
+    
     // Button layout
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     QPushButton *saveButton = new QPushButton("Save", this);
@@ -67,38 +146,67 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     mainLayout->addWidget(securityGroup);
     mainLayout->addWidget(typingGroup);
     mainLayout->addWidget(clipboardGroup);
+    mainLayout->addWidget(paletteGroup);
     mainLayout->addLayout(buttonLayout);
     
     // Connect signals
     connect(saveButton, &QPushButton::clicked, this, &SettingsDialog::saveSettings);
+    connect(burstModeCheck, &QCheckBox::toggled, burstChunkSizeBox, &QWidget::setEnabled);
+    connect(burstModeCheck, &QCheckBox::toggled, burstChunkDelayBox, &QWidget::setEnabled);
     connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+    connect(deliveryBox, &QComboBox::currentIndexChanged, this, [this]() {
+        pasteThresholdBox->setEnabled(deliveryBox->currentData().toString() == "Auto");
+    });
     
-    // Load current settings
+    // Load current settings, and again whenever they change elsewhere
     loadSettings();
+    connect(config, &AppConfig::changed, this, &SettingsDialog::loadSettings);
     
     // Set a reasonable size
-    resize(400, 400);
+    resize(400, 680);
 }
 
 void SettingsDialog::loadSettings()
 {
-    maskTextCheck->setChecked(settings.value("MaskText", false).toBool());
-    autoClearCheck->setChecked(settings.value("AutoClear", false).toBool());
-    useClipboardCheck->setChecked(settings.value("UseClipboard", false).toBool());
-    clearClipboardCheck->setChecked(settings.value("ClearClipboard", false).toBool());
-    typingDelayBox->setValue(settings.value("TypingDelay", 30).toInt());
-    clipboardClearDelayBox->setValue(settings.value("ClipboardClearDelay", 30).toInt());
+    const AppSettings &values = config->values();
+    maskTextCheck->setChecked(values.maskText);
+    autoClearCheck->setChecked(values.autoClear);
+    forgetTextBox->setValue(values.forgetTextAfter);
+    deliveryBox->setCurrentIndex(qMax(deliveryBox->findData(AppSettings::deliveryName(values.delivery)), 0));
+    pasteThresholdBox->setValue(values.pasteThreshold);
+    pasteThresholdBox->setEnabled(values.delivery == AppSettings::DeliverAuto);
+    clearClipboardCheck->setChecked(values.clearClipboard);
+    typingDelayBox->setValue(values.typingDelay);
+    clipboardClearDelayBox->setValue(values.clipboardClearDelay);
+    burstModeCheck->setChecked(values.burstMode);
+    burstChunkSizeBox->setValue(values.burstChunkSize);
+    burstChunkDelayBox->setValue(values.burstChunkDelay);
+    paletteHotkeyEdit->setKeySequence(QKeySequence(values.paletteHotkey));
+    directFireCheck->setChecked(values.directFire);
+    sequenceTimeoutBox->setValue(values.sequenceTimeout);
+    burstChunkSizeBox->setEnabled(values.burstMode);
+    burstChunkDelayBox->setEnabled(values.burstMode);
 }
 
 void SettingsDialog::saveSettings()
 {
-    settings.setValue("MaskText", maskTextCheck->isChecked());
-    settings.setValue("AutoClear", autoClearCheck->isChecked());
-    settings.setValue("UseClipboard", useClipboardCheck->isChecked());
-    settings.setValue("ClearClipboard", clearClipboardCheck->isChecked());
-    settings.setValue("TypingDelay", typingDelayBox->value());
-    settings.setValue("ClipboardClearDelay", clipboardClearDelayBox->value());
-    
-    settings.sync();
+    AppSettings values = config->values();
+    values.maskText = maskTextCheck->isChecked();
+    values.autoClear = autoClearCheck->isChecked();
+    values.forgetTextAfter = forgetTextBox->value();
+    values.delivery = AppSettings::deliveryFromName(deliveryBox->currentData().toString());
+    values.pasteThreshold = pasteThresholdBox->value();
+    values.clearClipboard = clearClipboardCheck->isChecked();
+    values.typingDelay = typingDelayBox->value();
+    values.clipboardClearDelay = clipboardClearDelayBox->value();
+    values.burstMode = burstModeCheck->isChecked();
+    values.burstChunkSize = burstChunkSizeBox->value();
+    values.burstChunkDelay = burstChunkDelayBox->value();
+    values.paletteHotkey = paletteHotkeyEdit->keySequence().toString(QKeySequence::PortableText);
+    values.directFire = directFireCheck->isChecked();
+    values.sequenceTimeout = sequenceTimeoutBox->value();
+    
+    // Written to disk in the background
+    config->update(values);
     accept();
 }
@@ -3,15 +3,19 @@
 
 #include <QDialog>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QSpinBox>
-#include <QSettings>
+#include <QDoubleSpinBox>
+#include <QKeySequenceEdit>
+
+class AppConfig;
 
 class SettingsDialog : public QDialog
 {
     Q_OBJECT
 
 public:
-    explicit SettingsDialog(QWidget *parent = nullptr);
+    explicit SettingsDialog(AppConfig *config, QWidget *parent = nullptr);
 
 private slots:
     void saveSettings();
@@ -19,11 +23,19 @@ private slots:
 private:
     QCheckBox *maskTextCheck;
     QCheckBox *autoClearCheck;
-    QCheckBox *useClipboardCheck;
     QCheckBox *clearClipboardCheck;
-    QSpinBox *typingDelayBox;
+    QCheckBox *burstModeCheck;
+    QCheckBox *directFireCheck;
+    QDoubleSpinBox *typingDelayBox;
     QSpinBox *clipboardClearDelayBox;
-    QSettings settings;
+    QSpinBox *burstChunkSizeBox;
+    QDoubleSpinBox *burstChunkDelayBox;
+    QSpinBox *forgetTextBox;
+    QSpinBox *sequenceTimeoutBox;
+    QSpinBox *pasteThresholdBox;
+    QComboBox *deliveryBox;
+    QKeySequenceEdit *paletteHotkeyEdit;
+    AppConfig *config;
 
     void loadSettings();
 };
@@ -0,0 +1,113 @@
+#include "snippetlistmodel.h"
+#include "mainwindow.h"
+#include <QColor>
+
+SnippetListModel::SnippetListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int SnippetListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(rows.size());
+}
+
+QVariant SnippetListModel::data(const QModelIndex &index, int role) const
+{
+    TextSnippet *snippet = snippetAt(index.row());
+    if (!snippet || index.parent().isValid()) {
+        return QVariant();
+    }
+
+    // Imported snippets may come without a hotkey
+    const bool hasHotkey = snippet->hotkeyKey != 0;
+    switch (role) {
+    case Qt::DisplayRole:
+        if (!hasHotkey) return snippet->name;
+        return QString("%1 [%2]").arg(snippet->name, MainWindow::hotkeyToString(snippet));
+    case Qt::ToolTipRole:
+        if (!hasHotkey) return snippet->name;
+        return snippet->hotkeyActive ? snippet->name
+                                     : snippet->name + "\nHotkey is inactive: it is already in use";
+    case Qt::ForegroundRole:
+        // Grey out snippets whose hotkey couldn't be registered
+        return snippet->hotkeyActive || !hasHotkey ? QVariant() : QVariant(QColor(Qt::gray));
+    case SnippetIdRole:
+        return snippet->hotkeyId;
+    default:
+        return QVariant();
+    }
+}
+
+TextSnippet *SnippetListModel::snippetAt(int row) const
+{
+    return row >= 0 && row < rows.size() ? rows[row] : nullptr;
+}
+
+int SnippetListModel::rowOf(int id) const
+{
+    return rowById.value(id, -1);
+}
+
+void SnippetListModel::setSnippets(const QList<TextSnippet*> &snippets)
+{
+    beginResetModel();
+    rows = snippets;
+    rowById.clear();
+    rowById.reserve(rows.size());
+    for (int row = 0; row < rows.size(); row++) {
+        rowById.insert(rows[row]->hotkeyId, row);
+    }
+    endResetModel();
+}
+
+void SnippetListModel::appendSnippet(TextSnippet *snippet)
+{
+    int row = int(rows.size());
+    beginInsertRows(QModelIndex(), row, row);
+    rows.append(snippet);
+    rowById.insert(snippet->hotkeyId, row);
+    endInsertRows();
+}
+
+void SnippetListModel::appendSnippets(const QList<TextSnippet*> &snippets)
+{
+    if (snippets.isEmpty()) return;
+
+    int first = int(rows.size());
+    beginInsertRows(QModelIndex(), first, first + int(snippets.size()) - 1);
+    rows.append(snippets);
+    for (int row = first; row < rows.size(); row++) {
+        rowById.insert(rows[row]->hotkeyId, row);
+    }
+    endInsertRows();
+}
+
+void SnippetListModel::removeSnippet(int id)
+{
+    int row = rowOf(id);
+    if (row < 0) return;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    rows.removeAt(row);
+    rowById.remove(id);
+    // Rows below the removed one move up
+    for (int i = row; i < rows.size(); i++) {
+        rowById[rows[i]->hotkeyId] = i;
+    }
+    endRemoveRows();
+}
+
+void SnippetListModel::snippetChanged(int id)
+{
+    int row = rowOf(id);
+    if (row < 0) return;
+
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+}
+
+void SnippetListModel::clear()
+{
+    setSnippets(QList<TextSnippet*>());
+}
@@ -0,0 +1,42 @@
+#ifndef SNIPPETLISTMODEL_H
+#define SNIPPETLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+
+class TextSnippet;
+
+// List model over the snippet store. Snippets are owned by MainWindow; the
+// model only keeps their display order. Labels are built when a view asks
+// for them, so only visible rows are ever formatted.
+class SnippetListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        SnippetIdRole = Qt::UserRole
+    };
+
+    explicit SnippetListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    TextSnippet *snippetAt(int row) const;
+    int rowOf(int id) const;
+
+    void setSnippets(const QList<TextSnippet*> &snippets);
+    void appendSnippet(TextSnippet *snippet);
+    void appendSnippets(const QList<TextSnippet*> &snippets);
+    void removeSnippet(int id);
+    void snippetChanged(int id);
+    void clear();
+
+private:
+    QList<TextSnippet*> rows;
+    QHash<int, int> rowById;
+};
+
+#endif // SNIPPETLISTMODEL_H
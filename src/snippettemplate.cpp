@@ -0,0 +1,140 @@
+#include "snippettemplate.h"
+#include <QClipboard>
+#include <QDateTime>
+#include <QGuiApplication>
+#include <cstring>
+
+SnippetTemplate::SnippetTemplate(const SecretText &text)
+    : source(text)
+    , pool(text ? text->rawText() : QString())
+{
+    qsizetype literalStart = 0;
+    qsizetype pos = 0;
+    bool hasCursor = false;
+
+    while ((pos = pool.indexOf('{', pos)) >= 0) {
+        qsizetype end = pool.indexOf('}', pos + 1);
+        if (end < 0) break;
+
+        // Arguments stay in the pool, just past the placeholder's name
+        QStringView token = QStringView(pool).mid(pos + 1, end - pos - 1);
+        Kind kind = Literal;
+        qsizetype argOffset = end;
+        qsizetype argLength = 0;
+        if (token == u"date") {
+            kind = Date;
+        } else if (token.startsWith(u"date:") && token.size() > 5) {
+            kind = Date;
+            argOffset = pos + 6;
+            argLength = token.size() - 5;
+        } else if (token.startsWith(u"env:") && token.size() > 4) {
+            kind = Env;
+            argOffset = pos + 5;
+            argLength = token.size() - 4;
+        } else if (token == u"clipboard") {
+            kind = Clipboard;
+        } else if (token == u"cursor") {
+            kind = Cursor;
+        }
+
+        if (kind == Literal) {
+            pos++;
+            continue;
+        }
+
+        append(Literal, literalStart, pos - literalStart);
+        // Only the first {cursor} counts, later ones are dropped
+        if (kind != Cursor || !hasCursor) {
+            append(kind, argOffset, argLength);
+        }
+        hasCursor = hasCursor || kind == Cursor;
+        literalStart = end + 1;
+        pos = end + 1;
+    }
+    append(Literal, literalStart, pool.size() - literalStart);
+
+    plain = parts.isEmpty() || (parts.size() == 1 && parts.first().kind == Literal);
+}
+
+void SnippetTemplate::append(Kind kind, qsizetype offset, qsizetype length)
+{
+    if (kind == Literal && length == 0) return;
+    parts.append({ kind, offset, length });
+}
+
+SnippetTemplate::Expansion SnippetTemplate::expand() const
+{
+    Expansion expansion;
+    if (plain) {
+        expansion.text = source;
+        return expansion;
+    }
+
+    // Placeholder values first, so the result is written once at its final size
+    QList<QString> values;
+    qsizetype size = 0;
+    for (const Part &part : parts) {
+        QStringView arg = QStringView(pool).mid(part.offset, part.length);
+        switch (part.kind) {
+        case Literal:
+            size += arg.size();
+            continue;
+        case Date:
+            if (arg.isEmpty()) {
+                values.append(QDate::currentDate().toString(Qt::ISODate));
+            } else {
+                values.append(QDateTime::currentDateTime().toString(arg));
+            }
+            break;
+        case Env:
+            values.append(qEnvironmentVariable(arg.toLocal8Bit().constData()));
+            break;
+        case Clipboard:
+            values.append(QGuiApplication::clipboard()->text());
+            break;
+        case Cursor:
+            continue;
+        }
+        size += values.last().size();
+    }
+
+    SecretBuffer buffer(size * qsizetype(sizeof(char16_t)));
+    char16_t *out = reinterpret_cast<char16_t*>(buffer.data());
+    char16_t *cursor = nullptr;
+    int value = 0;
+    for (const Part &part : parts) {
+        QStringView chunk;
+        if (part.kind == Literal) {
+            chunk = QStringView(pool).mid(part.offset, part.length);
+        } else if (part.kind == Cursor) {
+            cursor = out;
+            continue;
+        } else {
+            chunk = values.at(value++);
+        }
+        if (out && !chunk.isEmpty()) {
+            std::memcpy(out, chunk.utf16(), size_t(chunk.size()) * sizeof(char16_t));
+            out += chunk.size();
+        }
+    }
+
+    // One Left press per character typed after the cursor
+    if (cursor) {
+        for (const char16_t *c = cursor; c < out; c++) {
+            if (!QChar::isLowSurrogate(*c)) {
+                expansion.caretBack++;
+            }
+        }
+    }
+    expansion.text = SecretBuffer::share(std::move(buffer));
+    return expansion;
+}
+
+void SnippetTemplate::clear()
+{
+    // The text is wiped once its last reference is gone
+    pool.clear();
+    source.reset();
+    parts.clear();
+    plain = true;
+}
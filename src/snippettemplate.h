@@ -0,0 +1,63 @@
+#ifndef SNIPPETTEMPLATE_H
+#define SNIPPETTEMPLATE_H
+
+#include <QList>
+#include <QString>
+#include "securememory.h"
+
+// Snippet text with placeholders, parsed once into a list of parts so a
+// hotkey press only evaluates the dynamic ones:
+//
+//   {date}, {date:<format>}   current date, or date and time in a QDateTime format
+//   {env:NAME}                value of an environment variable
+//   {clipboard}               text on the clipboard
+//   {cursor}                  where the caret is left after typing
+//
+// Anything else in braces is typed as written. The template shares the
+// snippet's secure text and parses it in place.
+class SnippetTemplate
+{
+public:
+    struct Expansion
+    {
+        SecretText text;    // The snippet's own buffer when there are no placeholders
+        int caretBack = 0;  // Left presses that put the caret on {cursor}
+    };
+
+    SnippetTemplate() = default;
+    explicit SnippetTemplate(const SecretText &source);
+
+    bool isEmpty() const { return parts.isEmpty(); }
+
+    // Needs the GUI thread for {clipboard}
+    Expansion expand() const;
+
+    // Releases the parts and this reference to the text
+    void clear();
+
+private:
+    enum Kind : quint8 {
+        Literal,
+        Date,
+        Env,
+        Clipboard,
+        Cursor
+    };
+
+    // Literals and arguments are slices of one pool
+    struct Part
+    {
+        Kind kind;
+        qsizetype offset;
+        qsizetype length;
+    };
+
+    void append(Kind kind, qsizetype offset, qsizetype length);
+
+    SecretText source;
+    QString pool;       // Raw view of source
+    QList<Part> parts;
+    bool plain = true;  // A single literal, expanded without copying
+};
+
+#endif // SNIPPETTEMPLATE_H
@@ -0,0 +1,616 @@
+#include "snippettransfer.h"
+#include "vaultcrypto.h"
+#include "vaultfile.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QUuid>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QtConcurrentMap>
+#include <atomic>
+
+namespace {
+
+// Entries sealed or opened together; enough to keep every core busy
+const qsizetype BatchSize = 1024;
+// Resealing needs no parsing or writing in between, so fewer, larger batches
+const qsizetype ResealBatchSize = 8192;
+const qint64 JsonChunkSize = 64 * 1024;
+
+// KeePass entry field carrying the hotkey, so exports round-trip
+const char *const KeePassHotkeyKey = "KeyGhost Hotkey";
+
+QStringList splitTags(const QString &tags)
+{
+    static const QRegularExpression separators("[,;]");
+    QStringList result;
+    for (const QString &tag : tags.split(separators, Qt::SkipEmptyParts)) {
+        QString trimmed = tag.trimmed();
+        if (!trimmed.isEmpty()) {
+            result.append(trimmed);
+        }
+    }
+    return result;
+}
+
+// Moves parsed plaintext into secure memory and wipes the parser's copy
+void takeText(QString &text, TransferRecord &record)
+{
+    if (text.isEmpty()) return;
+    record.text = SecretBuffer::share(text);
+    SecureArena::wipe(text.data(), std::size_t(text.size()) * sizeof(QChar));
+    text.clear();
+}
+
+// Collects parsed entries and seals them a batch at a time
+class Importer
+{
+public:
+    Importer(QFile &file, const VaultCrypto &crypto, const SnippetTransfer::Progress &progress)
+        : file(file)
+        , crypto(crypto)
+        , progress(progress)
+        , canceled(false)
+    {
+    }
+
+    // False once the import was canceled
+    bool add(TransferRecord &&record)
+    {
+        if (record.name.isEmpty()) {
+            result.skipped++;
+            return true;
+        }
+        batch.append(std::move(record));
+        if (batch.size() >= BatchSize) {
+            seal();
+            canceled = progress && !progress(file.pos(), file.size());
+        }
+        return !canceled;
+    }
+
+    TransferResult finish(const QString &error)
+    {
+        if (canceled) {
+            result.error = "Canceled.";
+        } else if (!error.isEmpty()) {
+            result.error = error;
+        }
+        if (!result.error.isEmpty()) {
+            batch.clear();
+            result.records.clear();
+            return result;
+        }
+        seal();
+        return result;
+    }
+
+    QString readKeePassXml();
+    QString readCsv();
+    QString readJson();
+
+private:
+    void seal()
+    {
+        const VaultCrypto &crypto = this->crypto;
+        QtConcurrent::blockingMap(batch, [&crypto](TransferRecord &record) {
+            if (record.text && !record.text->isEmpty()) {
+                record.body = crypto.sealText(record.text->text());
+            }
+            record.text.reset();
+        });
+        result.records.append(batch);
+        batch.clear();
+    }
+
+    bool readKeePassGroup(QXmlStreamReader &xml, const QStringList &groups, bool topGroup);
+    bool readKeePassEntry(QXmlStreamReader &xml, const QStringList &groups);
+    bool addJsonObject(QByteArray &object, QString *error);
+
+    QFile &file;
+    const VaultCrypto &crypto;
+    const SnippetTransfer::Progress &progress;
+    QList<TransferRecord> batch;
+    TransferResult result;
+    bool canceled;
+};
+
+QString Importer::readKeePassXml()
+{
+    QXmlStreamReader xml(&file);
+    if (!xml.readNextStartElement() || xml.name() != QLatin1String("KeePassFile")) {
+        return "Not a KeePass XML file.";
+    }
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() != QLatin1String("Root")) {
+            xml.skipCurrentElement();
+            continue;
+        }
+        while (xml.readNextStartElement()) {
+            // The top group is the database itself, so it doesn't become a tag
+            if (xml.name() == QLatin1String("Group")) {
+                if (!readKeePassGroup(xml, QStringList(), true)) {
+                    return QString();
+                }
+            } else {
+                xml.skipCurrentElement();
+            }
+        }
+    }
+
+    if (xml.hasError()) {
+        return QString("Line %1: %2").arg(xml.lineNumber()).arg(xml.errorString());
+    }
+    return QString();
+}
+
+bool Importer::readKeePassGroup(QXmlStreamReader &xml, const QStringList &groups, bool topGroup)
+{
+    // Group names become tags of the entries inside
+    QStringList tags = groups;
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("Name")) {
+            QString name = xml.readElementText();
+            if (!topGroup && !name.isEmpty()) {
+                tags.append(name);
+            }
+        } else if (xml.name() == QLatin1String("Entry")) {
+            if (!readKeePassEntry(xml, tags)) return false;
+        } else if (xml.name() == QLatin1String("Group")) {
+            if (!readKeePassGroup(xml, tags, false)) return false;
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    return true;
+}
+
+bool Importer::readKeePassEntry(QXmlStreamReader &xml, const QStringList &groups)
+{
+    TransferRecord record;
+    record.tags = groups;
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("String")) {
+            QString key;
+            QString value;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("Key")) {
+                    key = xml.readElementText();
+                } else if (xml.name() == QLatin1String("Value")) {
+                    value = xml.readElementText();
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
+            if (key == QLatin1String("Title")) {
+                record.name = value;
+            } else if (key == QLatin1String("Password")) {
+                takeText(value, record);
+            } else if (key == QLatin1String(KeePassHotkeyKey)) {
+                record.hotkey = value;
+            }
+        } else if (xml.name() == QLatin1String("Tags")) {
+            record.tags.append(splitTags(xml.readElementText()));
+        } else {
+            // History holds older copies of the entry; those aren't imported
+            xml.skipCurrentElement();
+        }
+    }
+    return add(std::move(record));
+}
+
+// One record, with quoted fields spanning lines as needed
+bool readCsvRow(QTextStream &in, QStringList &fields)
+{
+    fields.clear();
+    if (in.atEnd()) return false;
+
+    QString field;
+    bool quoted = false;
+    QString line = in.readLine();
+    for (;;) {
+        for (qsizetype i = 0; i < line.size(); i++) {
+            QChar c = line[i];
+            if (quoted) {
+                if (c != '"') {
+                    field += c;
+                } else if (i + 1 < line.size() && line[i + 1] == '"') {
+                    field += c;
+                    i++;
+                } else {
+                    quoted = false;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                fields.append(field);
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        if (!quoted || in.atEnd()) break;
+        field += '\n';
+        SecureArena::wipe(line.data(), std::size_t(line.size()) * sizeof(QChar));
+        line = in.readLine();
+    }
+    fields.append(field);
+    SecureArena::wipe(line.data(), std::size_t(line.size()) * sizeof(QChar));
+    return true;
+}
+
+QString Importer::readCsv()
+{
+    QTextStream in(&file);
+    QStringList fields;
+    if (!readCsvRow(in, fields)) {
+        return "The CSV file is empty.";
+    }
+
+    // Our own columns, or those of KeePass, KeePassXC and most password managers
+    int nameColumn = -1;
+    int textColumn = -1;
+    int hotkeyColumn = -1;
+    int tagsColumn = -1;
+    int groupColumn = -1;
+    for (int i = 0; i < fields.size(); i++) {
+        QString column = fields[i].trimmed().toLower();
+        if (nameColumn < 0 && (column == "name" || column == "title" || column == "account")) {
+            nameColumn = i;
+        } else if (textColumn < 0 && (column == "text" || column == "password")) {
+            textColumn = i;
+        } else if (column == "hotkey") {
+            hotkeyColumn = i;
+        } else if (column == "tags") {
+            tagsColumn = i;
+        } else if (column == "group") {
+            groupColumn = i;
+        }
+    }
+    if (nameColumn < 0 || textColumn < 0) {
+        return "The first CSV row needs a name (or title) and a text (or password) column.";
+    }
+
+    while (readCsvRow(in, fields)) {
+        if (fields.size() == 1 && fields[0].isEmpty()) continue;
+
+        TransferRecord record;
+        record.name = fields.value(nameColumn).trimmed();
+        record.hotkey = fields.value(hotkeyColumn).trimmed();
+        record.tags = splitTags(fields.value(tagsColumn));
+        QString group = fields.value(groupColumn).trimmed();
+        if (!group.isEmpty()) {
+            record.tags.append(splitTags(group.replace('/', ',')));
+        }
+        if (textColumn < fields.size()) {
+            takeText(fields[textColumn], record);
+        }
+        if (!add(std::move(record))) break;
+    }
+    return QString();
+}
+
+bool Importer::addJsonObject(QByteArray &object, QString *error)
+{
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(object, &parseError);
+    SecureArena::wipe(object.data(), std::size_t(object.size()));
+    object.clear();
+    if (parseError.error != QJsonParseError::NoError) {
+        *error = parseError.errorString();
+        return false;
+    }
+
+    QJsonObject entry = document.object();
+    TransferRecord record;
+    record.name = entry.value(entry.contains("name") ? "name" : "title").toString();
+    record.hotkey = entry.value("hotkey").toString();
+    QJsonValue tags = entry.value("tags");
+    if (tags.isArray()) {
+        for (const QJsonValue &tag : tags.toArray()) {
+            if (!tag.toString().isEmpty()) {
+                record.tags.append(tag.toString());
+            }
+        }
+    } else {
+        record.tags = splitTags(tags.toString());
+    }
+    QString text = entry.value(entry.contains("text") ? "text" : "password").toString();
+    takeText(text, record);
+    return add(std::move(record));
+}
+
+QString Importer::readJson()
+{
+    // The top-level array is walked by hand; only one entry at a time is parsed
+    QByteArray object;
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    bool seenArray = false;
+    while (!file.atEnd()) {
+        QByteArray chunk = file.read(JsonChunkSize);
+        for (char c : std::as_const(chunk)) {
+            if (depth >= 2) {
+                object.append(c);
+            }
+            if (inString) {
+                if (escaped) {
+                    escaped = false;
+                } else if (c == '\\') {
+                    escaped = true;
+                } else if (c == '"') {
+                    inString = false;
+                }
+                continue;
+            }
+
+            switch (c) {
+            case '"':
+                inString = true;
+                break;
+            case '[':
+            case '{':
+                if (depth == 0 && c != '[') {
+                    return "Expected a JSON array of snippets.";
+                }
+                seenArray = true;
+                if (depth == 1) {
+                    if (c != '{') {
+                        return "Every snippet has to be a JSON object.";
+                    }
+                    object = "{";
+                }
+                depth++;
+                break;
+            case ']':
+            case '}':
+                depth--;
+                if (depth == 1) {
+                    QString error;
+                    if (!addJsonObject(object, &error)) {
+                        SecureArena::wipe(chunk.data(), std::size_t(chunk.size()));
+                        return canceled ? QString() : error;
+                    }
+                } else if (depth < 0) {
+                    return "Unbalanced JSON brackets.";
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        SecureArena::wipe(chunk.data(), std::size_t(chunk.size()));
+    }
+
+    if (!seenArray || depth != 0) {
+        SecureArena::wipe(object.data(), std::size_t(object.size()));
+        return "The JSON file ends early.";
+    }
+    return QString();
+}
+
+QByteArray csvField(QStringView value)
+{
+    QString quoted = value.toString();
+    quoted.replace('"', "\"\"");
+    QByteArray field = '"' + quoted.toUtf8() + '"';
+    SecureArena::wipe(quoted.data(), std::size_t(quoted.size()) * sizeof(QChar));
+    return field;
+}
+
+} // namespace
+
+SnippetTransfer::Format SnippetTransfer::formatOf(const QString &path)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "xml") return KeePassXml;
+    if (suffix == "csv") return Csv;
+    return Json;
+}
+
+QString SnippetTransfer::fileFilter()
+{
+    return "JSON (*.json);;CSV (*.csv);;KeePass 2 XML (*.xml)";
+}
+
+TransferResult SnippetTransfer::importFile(const QString &path, const VaultCrypto &crypto, const Progress &progress)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        TransferResult result;
+        result.error = file.errorString();
+        return result;
+    }
+
+    Importer importer(file, crypto, progress);
+    QString error;
+    switch (formatOf(path)) {
+    case KeePassXml: error = importer.readKeePassXml(); break;
+    case Csv: error = importer.readCsv(); break;
+    case Json: error = importer.readJson(); break;
+    }
+    return importer.finish(error);
+}
+
+QString SnippetTransfer::exportFile(const QString &path, const QList<TransferRecord> &records,
+                                    const VaultFile &vault, const VaultCrypto &crypto, const Progress &progress)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return file.errorString();
+    }
+
+    const Format format = formatOf(path);
+    QXmlStreamWriter xml(&file);
+    switch (format) {
+    case KeePassXml:
+        xml.setAutoFormatting(true);
+        xml.writeStartDocument();
+        xml.writeStartElement("KeePassFile");
+        xml.writeStartElement("Root");
+        xml.writeStartElement("Group");
+        xml.writeTextElement("Name", "KeyGhost");
+        break;
+    case Csv:
+        file.write("name,text,hotkey,tags\n");
+        break;
+    case Json:
+        file.write("[");
+        break;
+    }
+
+    std::atomic<int> unreadable(0);
+    bool firstEntry = true;
+    for (qsizetype first = 0; first < records.size(); first += BatchSize) {
+        // Texts of one batch are opened in parallel and wiped once written.
+        // The bodies are read in place, with the vault locked once per batch.
+        QList<TransferRecord> batch = records.mid(first, BatchSize);
+        {
+            VaultFile::Reader reader(vault);
+            QtConcurrent::blockingMap(batch, [&reader, &crypto, &unreadable](TransferRecord &record) {
+                QByteArrayView body = reader.body(record.id);
+                SecretBuffer plain;
+                if (!body.isEmpty() && !crypto.openText(body, plain)) {
+                    unreadable++;
+                    return;
+                }
+                record.text = SecretBuffer::share(std::move(plain));
+            });
+        }
+
+        for (const TransferRecord &record : std::as_const(batch)) {
+            QStringView text = record.text ? record.text->text() : QStringView();
+            QByteArray line;
+            switch (format) {
+            case KeePassXml:
+                xml.writeStartElement("Entry");
+                xml.writeTextElement("UUID", QString::fromLatin1(QUuid::createUuid().toRfc4122().toBase64()));
+                xml.writeStartElement("String");
+                xml.writeTextElement("Key", "Title");
+                xml.writeTextElement("Value", record.name);
+                xml.writeEndElement();
+                xml.writeStartElement("String");
+                xml.writeTextElement("Key", "Password");
+                xml.writeStartElement("Value");
+                xml.writeAttribute("ProtectInMemory", "True");
+                xml.writeCharacters(record.text ? record.text->rawText() : QString());
+                xml.writeEndElement();
+                xml.writeEndElement();
+                if (!record.hotkey.isEmpty()) {
+                    xml.writeStartElement("String");
+                    xml.writeTextElement("Key", KeePassHotkeyKey);
+                    xml.writeTextElement("Value", record.hotkey);
+                    xml.writeEndElement();
+                }
+                xml.writeTextElement("Tags", record.tags.join(';'));
+                xml.writeEndElement();
+                break;
+            case Csv:
+                line = csvField(record.name) + ',' + csvField(text) + ',' + csvField(record.hotkey)
+                    + ',' + csvField(record.tags.join(", ")) + '\n';
+                break;
+            case Json: {
+                QJsonObject entry;
+                entry.insert("name", record.name);
+                entry.insert("text", text.toString());
+                entry.insert("hotkey", record.hotkey);
+                entry.insert("tags", QJsonArray::fromStringList(record.tags));
+                line = (firstEntry ? "\n  " : ",\n  ") + QJsonDocument(entry).toJson(QJsonDocument::Compact);
+                firstEntry = false;
+                break;
+            }
+            }
+            file.write(line);
+            SecureArena::wipe(line.data(), std::size_t(line.size()));
+        }
+        batch.clear();
+
+        if (progress && !progress(qMin(first + BatchSize, records.size()), records.size())) {
+            file.cancelWriting();
+            return "Canceled.";
+        }
+    }
+
+    switch (format) {
+    case KeePassXml:
+        xml.writeEndDocument();
+        break;
+    case Csv:
+        break;
+    case Json:
+        file.write("\n]\n");
+        break;
+    }
+
+    if (unreadable > 0) {
+        file.cancelWriting();
+        return QString("%1 snippet texts could not be decrypted.").arg(int(unreadable));
+    }
+    if (!file.commit()) {
+        return file.errorString();
+    }
+    return QString();
+}
+
+TransferResult SnippetTransfer::reseal(const VaultFile &vault, const VaultCrypto &from, const VaultCrypto &to,
+                                       const Progress &progress)
+{
+    TransferResult result;
+    const QList<VaultRecord> stored = vault.index();
+    result.records.reserve(stored.size());
+    for (const VaultRecord &record : stored) {
+        TransferRecord resealed;
+        resealed.id = record.id;
+        result.records.append(resealed);
+    }
+
+    // Bytes go from one key to the other as they are, no text conversion;
+    // the plaintext only ever sits in secure memory
+    std::atomic<int> unreadable(0);
+    for (qsizetype first = 0; first < result.records.size(); first += ResealBatchSize) {
+        auto begin = result.records.begin() + first;
+        auto end = result.records.begin() + qMin(first + ResealBatchSize, result.records.size());
+        // One lock per batch; the workers read the bodies in place
+        {
+            VaultFile::Reader reader(vault);
+            QtConcurrent::blockingMap(begin, end, [&reader, &from, &to, &unreadable](TransferRecord &record) {
+                QByteArrayView body = reader.body(record.id);
+                if (body.isEmpty()) return;
+
+                const qsizetype size = body.size() - VaultCrypto::Overhead;
+                SecretBuffer plain(size);
+                char empty = 0;
+                char *out = size == 0 ? &empty : plain.data();
+                QByteArray sealed(body.size(), Qt::Uninitialized);
+                if (size < 0 || plain.size() != size || !from.open(body.constData(), body.size(), out)
+                    || !to.seal(out, size, sealed.data())) {
+                    unreadable++;
+                    return;
+                }
+                record.body = sealed;
+            });
+        }
+
+        if (progress && !progress(end - result.records.begin(), result.records.size())) {
+            result.records.clear();
+            result.error = "Canceled.";
+            return result;
+        }
+    }
+
+    if (unreadable > 0) {
+        result.records.clear();
+        result.error = QString("%1 snippet texts could not be decrypted, so the key was left as it is.")
+                           .arg(int(unreadable));
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef SNIPPETTRANSFER_H
+#define SNIPPETTRANSFER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include "securememory.h"
+
+class VaultCrypto;
+class VaultFile;
+
+// One snippet on its way into or out of the vault
+struct TransferRecord
+{
+    int id = -1;
+    QString name;
+    QString hotkey;         // QKeySequence portable text, empty for none
+    QStringList tags;
+    SecretText text;        // Only while its batch is being sealed or written
+    QByteArray body;        // Sealed text
+};
+
+struct TransferResult
+{
+    QList<TransferRecord> records;  // Sealed, without text and ids
+    int skipped = 0;                // Entries without a name
+    QString error;
+};
+
+// Bulk import and export in KeePass 2 XML, CSV and JSON. Files are read and
+// written incrementally in batches; each batch is sealed or opened on all
+// cores, so plaintext never exists for more than one batch at a time.
+class SnippetTransfer
+{
+public:
+    enum Format {
+        KeePassXml,
+        Csv,
+        Json
+    };
+
+    // Reports progress; returning false cancels
+    using Progress = std::function<bool(qint64 done, qint64 total)>;
+
+    // Picked by the file suffix
+    static Format formatOf(const QString &path);
+    // For QFileDialog
+    static QString fileFilter();
+
+    // Reads the file and seals every entry with crypto
+    static TransferResult importFile(const QString &path, const VaultCrypto &crypto, const Progress &progress);
+
+    // Writes records with their texts opened from vault. The file is only
+    // replaced once complete. Returns an error message, empty on success.
+    static QString exportFile(const QString &path, const QList<TransferRecord> &records,
+                              const VaultFile &vault, const VaultCrypto &crypto, const Progress &progress);
+
+    // Opens every body in vault with from and seals it again with to, on all
+    // cores. Records carry id and new body; the vault itself is left alone.
+    static TransferResult reseal(const VaultFile &vault, const VaultCrypto &from, const VaultCrypto &to,
+                                 const Progress &progress);
+};
+
+#endif // SNIPPETTRANSFER_H
@@ -0,0 +1,155 @@
+#include "snippettraymenu.h"
+#include "snippetlistmodel.h"
+#include "mainwindow.h"
+#include <limits>
+
+SnippetTrayMenu::SnippetTrayMenu(SnippetListModel *model, QWidget *parent)
+    : QMenu("Type Snippets", parent)
+    , model(model)
+{
+    // One connection for every action, including the ones in nested submenus
+    connect(this, &QMenu::triggered, this, [this](QAction *action) {
+        QVariant id = action->data();
+        if (id.isValid()) {
+            emit snippetTriggered(id.toInt());
+        }
+    });
+
+    sections.insert(this, Section());
+    connect(this, &QMenu::aboutToShow, this, [this]() {
+        if (!sections.value(this).filled) {
+            fill(this);
+        }
+    });
+
+    connect(model, &QAbstractItemModel::modelReset, this, [this]() {
+        // Every row may have moved, so nothing below the top is worth keeping
+        const QList<QAction*> actions = this->actions();
+        for (QAction *action : actions) {
+            if (action->menu()) {
+                removeSection(action->menu());
+            }
+        }
+        clear();
+        sections[this].filled = false;
+        menuAction()->setVisible(this->model->rowCount() > 0);
+    });
+    connect(model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &, int first) {
+        rowsChanged(first, std::numeric_limits<int>::max(), true);
+    });
+    connect(model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &, int first) {
+        rowsChanged(first, std::numeric_limits<int>::max(), true);
+    });
+    connect(model, &QAbstractItemModel::dataChanged, this,
+            [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+        rowsChanged(topLeft.row(), bottomRight.row(), false);
+    });
+
+    menuAction()->setVisible(model->rowCount() > 0);
+}
+
+void SnippetTrayMenu::fill(QMenu *menu)
+{
+    // The reference is only used before submenus are added to the hash
+    Section &section = sections[menu];
+    if (menu == this) {
+        section.count = model->rowCount();
+    }
+    section.filled = true;
+    const int first = section.first;
+    const int count = section.count;
+    const int end = qMin(first + count, model->rowCount());
+
+    // Submenus are taken out first, so clear() doesn't touch them
+    QHash<int, QMenu*> previous;
+    const QList<QAction*> actions = menu->actions();
+    for (QAction *action : actions) {
+        if (QMenu *child = action->menu()) {
+            previous.insert(sections.value(child).first, child);
+        }
+    }
+    menu->clear();
+
+    if (count <= PageSize) {
+        for (QMenu *child : std::as_const(previous)) {
+            removeSection(child);
+        }
+        for (int row = first; row < end; row++) {
+            TextSnippet *snippet = model->snippetAt(row);
+            QAction *action = menu->addAction(snippet->name);
+            action->setData(snippet->hotkeyId);
+        }
+        return;
+    }
+
+    // Smallest span of rows per entry that keeps this menu within FolderSize
+    qint64 span = PageSize;
+    while (span * FolderSize < count) {
+        span *= FolderSize;
+    }
+
+    // Submenus covering the same rows as before are kept with their contents
+    for (qint64 start = first; start < first + qint64(count); start += span) {
+        const int childCount = int(qMin(span, first + qint64(count) - start));
+        QMenu *child = previous.take(int(start));
+        if (child && sections.value(child).count == childCount) {
+            menu->addMenu(child);
+            continue;
+        }
+        if (child) {
+            removeSection(child);
+        }
+        addSection(menu, int(start), childCount);
+    }
+    for (QMenu *child : std::as_const(previous)) {
+        removeSection(child);
+    }
+}
+
+void SnippetTrayMenu::addSection(QMenu *parent, int first, int count)
+{
+    QMenu *menu = new QMenu(QString("%1 - %2").arg(first + 1).arg(first + count), parent);
+    Section section;
+    section.first = first;
+    section.count = count;
+    sections.insert(menu, section);
+
+    connect(menu, &QMenu::aboutToShow, this, [this, menu]() {
+        if (!sections.value(menu).filled) {
+            fill(menu);
+        }
+    });
+    parent->addMenu(menu);
+}
+
+void SnippetTrayMenu::removeSection(QMenu *menu)
+{
+    const QList<QAction*> actions = menu->actions();
+    for (QAction *action : actions) {
+        if (action->menu()) {
+            removeSection(action->menu());
+        }
+    }
+    sections.remove(menu);
+    delete menu;
+}
+
+void SnippetTrayMenu::rowsChanged(int first, int last, bool moved)
+{
+    menuAction()->setVisible(model->rowCount() > 0);
+
+    // Pages over the changed rows are refilled when next shown. Inserts and
+    // removals also change the top menu's range; folders keep theirs.
+    for (auto it = sections.begin(); it != sections.end(); ++it) {
+        Section &section = it.value();
+        if (it.key() == this) {
+            if (moved || section.count <= PageSize) {
+                section.filled = false;
+            }
+            continue;
+        }
+        if (section.count <= PageSize && section.first <= last && first < section.first + section.count) {
+            section.filled = false;
+        }
+    }
+}
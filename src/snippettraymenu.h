@@ -0,0 +1,45 @@
+#ifndef SNIPPETTRAYMENU_H
+#define SNIPPETTRAYMENU_H
+
+#include <QMenu>
+#include <QHash>
+
+class SnippetListModel;
+
+// "Type Snippets" tray submenu kept in sync with the snippet list model.
+// Large vaults are split into pages of PageSize snippets, and pages are
+// grouped into folders of at most FolderSize entries, nested as deep as
+// needed. A menu's actions or submenus are only created when it's about to
+// be shown; model changes just mark the menus they touch for a refill.
+class SnippetTrayMenu : public QMenu
+{
+    Q_OBJECT
+
+public:
+    static const int PageSize = 50;
+    static const int FolderSize = 50;
+
+    SnippetTrayMenu(SnippetListModel *model, QWidget *parent = nullptr);
+
+signals:
+    void snippetTriggered(int id);
+
+private:
+    // Rows a menu covers; only the top menu's range changes with the model
+    struct Section
+    {
+        int first = 0;
+        int count = 0;
+        bool filled = false;
+    };
+
+    void fill(QMenu *menu);
+    void addSection(QMenu *parent, int first, int count);
+    void removeSection(QMenu *menu);
+    void rowsChanged(int first, int last, bool moved);
+
+    SnippetListModel *model;
+    QHash<QMenu*, Section> sections;    // This menu and the submenus created so far
+};
+
+#endif // SNIPPETTRAYMENU_H
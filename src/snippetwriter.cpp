@@ -0,0 +1,133 @@
+#include "snippetwriter.h"
+#include "vaultcrypto.h"
+#include "vaultfile.h"
+#include "snippettransfer.h"
+#include <QHash>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QSettings>
+
+namespace {
+
+// Records per batch, small enough to keep the GUI thread responsive while it lists them
+const qsizetype LoadBatchSize = 256;
+
+} // namespace
+
+SnippetWriter::SnippetWriter(VaultFile *vault, const VaultCrypto *crypto, QObject *parent)
+    : QObject(parent)
+    , vault(vault)
+    , crypto(crypto)
+{
+}
+
+void SnippetWriter::load()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!vault->load()) {
+        if (vault->exists()) {
+            emit loadFinished(QString("The snippet vault %1 could not be read.").arg(vault->path()));
+            return;
+        }
+        
+        // Snippets used to live in QSettings; move them into the vault file once
+        QSettings settings;
+        settings.beginGroup("Snippets");
+        bool hasLegacySnippets = !settings.childGroups().isEmpty();
+        settings.endGroup();
+        
+        if (hasLegacySnippets) {
+            if (!vault->importSettings(settings, *crypto)) {
+                emit loadFinished("Failed to move the stored snippets into the vault file.");
+                return;
+            }
+            settings.remove("Snippets");
+        }
+    }
+
+    // The index holds everything except the texts, those are decrypted on first use
+    const QList<VaultRecord> records = vault->index();
+    qInfo("Startup: vault read in %.1f ms, %lld snippets",
+          timer.nsecsElapsed() / 1e6, qlonglong(records.size()));
+
+    for (qsizetype i = 0; i < records.size(); i += LoadBatchSize) {
+        emit recordsLoaded(records.mid(i, LoadBatchSize));
+    }
+    emit loadFinished(QString());
+}
+
+void SnippetWriter::write(const QList<SnippetRecord> &changed, const QList<int> &removed, int generation)
+{
+    // Start from the stored index; its bodies stay in the file
+    QMap<int, VaultRecord> records;
+    const QList<VaultRecord> stored = vault->index();
+    for (const VaultRecord &record : stored) {
+        records.insert(record.id, record);
+    }
+
+    for (int id : removed) {
+        records.remove(id);
+    }
+
+    for (const SnippetRecord &snippet : changed) {
+        VaultRecord &record = records[snippet.id];
+        record.id = snippet.id;
+        record.name = snippet.name;
+        record.hotkeyModifiers = snippet.hotkeyModifiers;
+        record.hotkeyKey = snippet.hotkeyKey;
+        record.tags = snippet.tags;
+        record.hotkeyTail = snippet.hotkeyTail;
+        if (snippet.textChanged || !record.keepBody) {
+            record.body = snippet.text ? crypto->sealText(snippet.text->text()) : QByteArray();
+            record.keepBody = false;
+        }
+    }
+
+    if (!vault->save(records.values())) {
+        qWarning("Failed to save %lld snippet changes", qlonglong(changed.size() + removed.size()));
+        return;
+    }
+    emit written(generation);
+}
+
+bool SnippetWriter::add(const QList<VaultRecord> &added, int generation)
+{
+    QList<VaultRecord> records = vault->index();
+    records.append(added);
+    if (!vault->save(records)) {
+        qWarning("Failed to save %lld added snippets", qlonglong(added.size()));
+        return false;
+    }
+    emit written(generation);
+    return true;
+}
+
+bool SnippetWriter::rekey(const QList<TransferRecord> &resealed, const QByteArray &wrappedKey, const VaultCrypto *newCrypto)
+{
+    QHash<int, QByteArray> bodies;
+    bodies.reserve(resealed.size());
+    for (const TransferRecord &record : resealed) {
+        bodies.insert(record.id, record.body);
+    }
+
+    QList<VaultRecord> records = vault->index();
+    for (VaultRecord &record : records) {
+        auto it = bodies.constFind(record.id);
+        if (it == bodies.constEnd()) {
+            qWarning("Snippet %d was added during the key rotation", record.id);
+            return false;
+        }
+        record.body = *it;
+        record.keepBody = false;
+    }
+
+    // The new vault is written in full next to the old one and renamed over it
+    if (!vault->save(records, wrappedKey)) {
+        qWarning("Failed to save %lld resealed snippets", qlonglong(records.size()));
+        return false;
+    }
+    crypto = newCrypto;
+    return true;
+}
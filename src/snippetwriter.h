@@ -0,0 +1,64 @@
+#ifndef SNIPPETWRITER_H
+#define SNIPPETWRITER_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "securememory.h"
+#include "vaultfile.h"
+
+class VaultCrypto;
+struct TransferRecord;
+
+// Snapshot of one snippet handed to the writer thread
+struct SnippetRecord
+{
+    int id = -1;
+    QString name;
+    SecretText text;    // Shared with the snippet, not copied
+    int hotkeyModifiers = 0;
+    int hotkeyKey = 0;
+    QStringList tags;
+    QString hotkeyTail;
+    bool textChanged = false; // Otherwise the stored ciphertext is kept as is
+};
+
+// Loads the vault and persists snippet changes to it on a background thread.
+// Only changed texts are encrypted; other bodies are copied from the old file.
+class SnippetWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    SnippetWriter(VaultFile *vault, const VaultCrypto *crypto, QObject *parent = nullptr);
+
+public slots:
+    // Maps the vault, moving snippets from older versions' settings into it
+    // first, and streams its index out through recordsLoaded() in batches.
+    // loadFinished() follows with an error message, empty on success.
+    void load();
+
+    // Applies changed and removed snippets to the vault. generation is
+    // reported back through written() once the file is saved.
+    void write(const QList<SnippetRecord> &changed, const QList<int> &removed, int generation);
+
+    // Adds records with sealed bodies in one save; false if it failed
+    bool add(const QList<VaultRecord> &added, int generation);
+
+    // Switches the vault to bodies resealed under a new data key and writes
+    // with newCrypto from then on. Fails, changing nothing, unless every
+    // stored record has a resealed body.
+    bool rekey(const QList<TransferRecord> &resealed, const QByteArray &wrappedKey, const VaultCrypto *newCrypto);
+
+signals:
+    void recordsLoaded(const QList<VaultRecord> &records);
+    void loadFinished(const QString &error);
+    void written(int generation);
+
+private:
+    VaultFile *vault;
+    const VaultCrypto *crypto;
+};
+
+#endif // SNIPPETWRITER_H
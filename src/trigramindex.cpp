@@ -0,0 +1,304 @@
+#include "trigramindex.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+enum GramKind : quint64 {
+    AnyChar = 0,
+    WordStart = 1,
+    Trigram = 2
+};
+
+// Up to three UTF-16 units packed below the kind. A word-start bigram can't
+// collide with a single character because its first unit is never zero.
+quint64 gramKey(GramKind kind, const QChar *chars, int length)
+{
+    quint64 key = quint64(kind) << 48;
+    for (int i = 0; i < length; i++) {
+        key |= quint64(chars[i].unicode()) << (16 * (length - 1 - i));
+    }
+    return key;
+}
+
+bool isWordStart(const QString &text, qsizetype pos)
+{
+    return text[pos].isLetterOrNumber() && (pos == 0 || !text[pos - 1].isLetterOrNumber());
+}
+
+// Best placement of term inside text: prefix, word start, or anywhere
+int containScore(const QString &text, const QString &term, int prefix, int word, int inside)
+{
+    qsizetype pos = text.indexOf(term);
+    if (pos < 0) return 0;
+    if (pos == 0) return prefix;
+
+    int best = inside;
+    for (; pos >= 0; pos = text.indexOf(term, pos + 1)) {
+        if (isWordStart(text, pos)) {
+            best = word;
+            break;
+        }
+    }
+    return best;
+}
+
+// Matches term as a subsequence of text; tighter matches score higher
+int subsequenceScore(const QString &text, const QString &term, int base)
+{
+    qsizetype pos = -1;
+    qsizetype first = -1;
+    for (QChar c : term) {
+        pos = text.indexOf(c, pos + 1);
+        if (pos < 0) return 0;
+        if (first < 0) first = pos;
+    }
+    qsizetype gaps = (pos - first + 1) - term.size();
+    return qMax(1, base - int(qMin<qsizetype>(gaps, base - 1)));
+}
+
+} // namespace
+
+TrigramIndex::TrigramIndex()
+    : deadCount(0)
+{
+}
+
+void TrigramIndex::insert(int id, const QString &name, const QStringList &tags)
+{
+    remove(id);
+
+    Document document;
+    document.id = id;
+    document.name = name.toCaseFolded();
+    document.tags = tags.join(' ').toCaseFolded();
+    document.alive = true;
+
+    quint32 slot = quint32(documents.size());
+    documents.push_back(document);
+    slotById.insert(id, slot);
+
+    addGrams(slot, document.name);
+    addGrams(slot, document.tags);
+}
+
+void TrigramIndex::remove(int id)
+{
+    auto it = slotById.find(id);
+    if (it == slotById.end()) return;
+
+    documents[*it].alive = false;
+    documents[*it].name.clear();
+    documents[*it].tags.clear();
+    slotById.erase(it);
+    deadCount++;
+
+    if (deadCount > 1024 && deadCount > size()) {
+        compact();
+    }
+}
+
+void TrigramIndex::clear()
+{
+    documents.clear();
+    slotById.clear();
+    postings.clear();
+    deadCount = 0;
+}
+
+QList<TrigramIndex::Match> TrigramIndex::search(const QString &query, int limit) const
+{
+    QList<Match> matches;
+    std::vector<Ranked> ranked;
+    const QStringList terms = query.toCaseFolded().split(' ', Qt::SkipEmptyParts);
+    if (terms.isEmpty() || limit <= 0) {
+        return matches;
+    }
+
+    // Candidates have every gram of every term
+    std::vector<const Postings*> lists;
+    for (const QString &term : terms) {
+        if (term.size() < 3) {
+            lists.push_back(find(gramKey(WordStart, term.constData(), int(term.size()))));
+        } else {
+            for (qsizetype i = 0; i + 3 <= term.size(); i++) {
+                lists.push_back(find(gramKey(Trigram, term.constData() + i, 3)));
+            }
+        }
+    }
+
+    Postings candidates;
+    if (intersect(lists, candidates)) {
+        for (quint32 slot : candidates) {
+            const Document &document = documents[slot];
+            if (!document.alive) continue;
+
+            int score = 0;
+            for (const QString &term : terms) {
+                int termMatch = termScore(document, term);
+                if (termMatch == 0) {
+                    score = 0;
+                    break;
+                }
+                score += termMatch;
+            }
+            if (score > 0) {
+                ranked.push_back({ score, int(document.name.size()), document.id });
+            }
+        }
+    }
+
+    // Nothing contains the terms; fall back to subsequence matching over the
+    // documents that have all of the characters
+    if (ranked.empty()) {
+        lists.clear();
+        for (const QString &term : terms) {
+            for (QChar c : term) {
+                lists.push_back(find(gramKey(AnyChar, &c, 1)));
+            }
+        }
+
+        candidates.clear();
+        if (intersect(lists, candidates)) {
+            for (quint32 slot : candidates) {
+                const Document &document = documents[slot];
+                if (!document.alive) continue;
+
+                int score = 0;
+                for (const QString &term : terms) {
+                    int termMatch = fuzzyScore(document, term);
+                    if (termMatch == 0) {
+                        score = 0;
+                        break;
+                    }
+                    score += termMatch;
+                }
+                if (score > 0) {
+                    ranked.push_back({ score, int(document.name.size()), document.id });
+                }
+            }
+        }
+    }
+
+    // Only the top of the list is shown, so don't sort the rest. Ties go to
+    // the shorter name.
+    auto better = [](const Ranked &a, const Ranked &b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.length != b.length) return a.length < b.length;
+        return a.id < b.id;
+    };
+    size_t top = qMin(size_t(limit), ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + top, ranked.end(), better);
+
+    matches.reserve(qsizetype(top));
+    for (size_t i = 0; i < top; i++) {
+        matches.append({ ranked[i].id, ranked[i].score });
+    }
+    return matches;
+}
+
+void TrigramIndex::addGrams(quint32 slot, const QString &text)
+{
+    const QChar *chars = text.constData();
+    const qsizetype length = text.size();
+    for (qsizetype i = 0; i < length; i++) {
+        if (chars[i].isSpace()) continue;
+
+        addGram(gramKey(AnyChar, chars + i, 1), slot);
+        if (isWordStart(text, i)) {
+            addGram(gramKey(WordStart, chars + i, 1), slot);
+            if (i + 1 < length && !chars[i + 1].isSpace()) {
+                addGram(gramKey(WordStart, chars + i, 2), slot);
+            }
+        }
+        if (i + 2 < length && !chars[i + 1].isSpace() && !chars[i + 2].isSpace()) {
+            addGram(gramKey(Trigram, chars + i, 3), slot);
+        }
+    }
+}
+
+void TrigramIndex::addGram(quint64 key, quint32 slot)
+{
+    // Slots only grow, so lists stay sorted and a repeat is always at the back
+    Postings &list = postings[key];
+    if (list.empty() || list.back() != slot) {
+        list.push_back(slot);
+    }
+}
+
+const TrigramIndex::Postings *TrigramIndex::find(quint64 key) const
+{
+    auto it = postings.constFind(key);
+    return it == postings.constEnd() ? nullptr : &*it;
+}
+
+bool TrigramIndex::intersect(const std::vector<const Postings*> &lists, Postings &result) const
+{
+    if (lists.empty()) return false;
+    for (const Postings *list : lists) {
+        if (!list) return false;
+    }
+
+    // Start from the shortest list so every step only shrinks the result
+    std::vector<const Postings*> sorted = lists;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    std::sort(sorted.begin(), sorted.end(), [](const Postings *a, const Postings *b) {
+        return a->size() < b->size();
+    });
+
+    result = *sorted.front();
+    Postings next;
+    for (size_t i = 1; i < sorted.size() && !result.empty(); i++) {
+        next.clear();
+        std::set_intersection(result.begin(), result.end(),
+                              sorted[i]->begin(), sorted[i]->end(), std::back_inserter(next));
+        result.swap(next);
+    }
+    return !result.empty();
+}
+
+int TrigramIndex::termScore(const Document &document, const QString &term) const
+{
+    if (document.name == term) return 1000;
+
+    int score = containScore(document.name, term, 800, 600, 400);
+    if (score == 0) {
+        score = containScore(document.tags, term, 300, 300, 200);
+    }
+    return score;
+}
+
+int TrigramIndex::fuzzyScore(const Document &document, const QString &term) const
+{
+    int score = subsequenceScore(document.name, term, 100);
+    if (score == 0) {
+        score = subsequenceScore(document.tags, term, 50);
+    }
+    return score;
+}
+
+void TrigramIndex::compact()
+{
+    std::vector<Document> live;
+    live.reserve(slotById.size());
+    for (Document &document : documents) {
+        if (document.alive) {
+            live.push_back(std::move(document));
+        }
+    }
+
+    documents.clear();
+    slotById.clear();
+    postings.clear();
+    deadCount = 0;
+
+    documents.reserve(live.size());
+    for (Document &document : live) {
+        quint32 slot = quint32(documents.size());
+        slotById.insert(document.id, slot);
+        addGrams(slot, document.name);
+        addGrams(slot, document.tags);
+        documents.push_back(std::move(document));
+    }
+}
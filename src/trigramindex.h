@@ -0,0 +1,73 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+// Search index over snippet names and tags. Text is case folded and split
+// into grams that map to sorted posting lists:
+//
+//   - every character, for subsequence (fuzzy) matching
+//   - the first one and two characters of each word, for short queries
+//   - every three-character run, for longer queries
+//
+// A query intersects the posting lists of its grams, so only snippets that
+// can match are scored. Removed documents are tombstoned and the index is
+// compacted once they outnumber the live ones.
+class TrigramIndex
+{
+public:
+    struct Match
+    {
+        int id;
+        int score;
+    };
+
+    TrigramIndex();
+
+    // Adds the snippet, replacing an earlier entry with the same id
+    void insert(int id, const QString &name, const QStringList &tags);
+    void remove(int id);
+    void clear();
+
+    int size() const { return int(slotById.size()); }
+
+    // Best matches first. Every whitespace-separated term has to match.
+    QList<Match> search(const QString &query, int limit) const;
+
+private:
+    struct Document
+    {
+        int id;
+        QString name;   // Case folded
+        QString tags;   // Case folded, separated by spaces
+        bool alive;
+    };
+
+    struct Ranked
+    {
+        int score;
+        int length;
+        int id;
+    };
+
+    using Postings = std::vector<quint32>;
+
+    void addGrams(quint32 slot, const QString &text);
+    void addGram(quint64 key, quint32 slot);
+    const Postings *find(quint64 key) const;
+    bool intersect(const std::vector<const Postings*> &lists, Postings &result) const;
+    int termScore(const Document &document, const QString &term) const;
+    int fuzzyScore(const Document &document, const QString &term) const;
+    void compact();
+
+    std::vector<Document> documents;
+    QHash<int, quint32> slotById;
+    QHash<quint64, Postings> postings;
+    int deadCount;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,312 @@
+#include "uinputbackend.h"
+#include <QThread>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+namespace {
+
+// Most characters written at once. evdev readers have small per-client
+// queues and drop the whole queue on overflow, so bursts are kept short.
+const int MaxBurstChars = 64;
+
+struct UsKey {
+    quint16 code;
+    bool shift;
+};
+
+// US QWERTY key for a printable ASCII character, code 0 if there is none
+UsKey usKeyFor(char32_t ucs4)
+{
+    static const quint16 letters[26] = {
+        KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I,
+        KEY_J, KEY_K, KEY_L, KEY_M, KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R,
+        KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z
+    };
+    static const quint16 digits[10] = {
+        KEY_0, KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8, KEY_9
+    };
+
+    if (ucs4 >= 'a' && ucs4 <= 'z') return { letters[ucs4 - 'a'], false };
+    if (ucs4 >= 'A' && ucs4 <= 'Z') return { letters[ucs4 - 'A'], true };
+    if (ucs4 >= '0' && ucs4 <= '9') return { digits[ucs4 - '0'], false };
+
+    switch (ucs4) {
+    case ' ':  return { KEY_SPACE, false };
+    case '\n':
+    case '\r': return { KEY_ENTER, false };
+    case '\t': return { KEY_TAB, false };
+    case '\b': return { KEY_BACKSPACE, false };
+    case '!':  return { KEY_1, true };
+    case '@':  return { KEY_2, true };
+    case '#':  return { KEY_3, true };
+    case '$':  return { KEY_4, true };
+    case '%':  return { KEY_5, true };
+    case '^':  return { KEY_6, true };
+    case '&':  return { KEY_7, true };
+    case '*':  return { KEY_8, true };
+    case '(':  return { KEY_9, true };
+    case ')':  return { KEY_0, true };
+    case '-':  return { KEY_MINUS, false };
+    case '_':  return { KEY_MINUS, true };
+    case '=':  return { KEY_EQUAL, false };
+    case '+':  return { KEY_EQUAL, true };
+    case '[':  return { KEY_LEFTBRACE, false };
+    case '{':  return { KEY_LEFTBRACE, true };
+    case ']':  return { KEY_RIGHTBRACE, false };
+    case '}':  return { KEY_RIGHTBRACE, true };
+    case '\\': return { KEY_BACKSLASH, false };
+    case '|':  return { KEY_BACKSLASH, true };
+    case ';':  return { KEY_SEMICOLON, false };
+    case ':':  return { KEY_SEMICOLON, true };
+    case '\'': return { KEY_APOSTROPHE, false };
+    case '"':  return { KEY_APOSTROPHE, true };
+    case '`':  return { KEY_GRAVE, false };
+    case '~':  return { KEY_GRAVE, true };
+    case ',':  return { KEY_COMMA, false };
+    case '<':  return { KEY_COMMA, true };
+    case '.':  return { KEY_DOT, false };
+    case '>':  return { KEY_DOT, true };
+    case '/':  return { KEY_SLASH, false };
+    case '?':  return { KEY_SLASH, true };
+    }
+
+    return { 0, false };
+}
+
+} // namespace
+
+UinputBackend::UinputBackend()
+    : fd(-1)
+{
+}
+
+UinputBackend::~UinputBackend()
+{
+    if (fd >= 0) {
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+    }
+}
+
+bool UinputBackend::isAvailable() const
+{
+    return fd >= 0 || access("/dev/uinput", W_OK) == 0;
+}
+
+bool UinputBackend::ensureDevice()
+{
+    if (fd >= 0) {
+        return true;
+    }
+
+    fd = open("/dev/uinput", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        qWarning("Failed to open /dev/uinput: %s", strerror(errno));
+        return false;
+    }
+
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    for (int code = KEY_ESC; code <= KEY_COMPOSE; ++code) {
+        ioctl(fd, UI_SET_KEYBIT, code);
+    }
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x4b47;
+    setup.id.product = 0x0001;
+    strncpy(setup.name, "KeyGhost virtual keyboard", UINPUT_MAX_NAME_SIZE - 1);
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        qWarning("Failed to create uinput device: %s", strerror(errno));
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // The compositor needs a moment to pick up the new device before it
+    // delivers its events; this only happens on the first send
+    QThread::msleep(200);
+    return true;
+}
+
+void UinputBackend::appendEvent(quint16 type, quint16 code, qint32 value)
+{
+    struct input_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    events.append(reinterpret_cast<const char*>(&event), sizeof(event));
+}
+
+void UinputBackend::appendTap(quint16 code, bool shift)
+{
+    if (shift) {
+        appendEvent(EV_KEY, KEY_LEFTSHIFT, 1);
+        appendEvent(EV_SYN, SYN_REPORT, 0);
+    }
+    appendEvent(EV_KEY, code, 1);
+    appendEvent(EV_SYN, SYN_REPORT, 0);
+    appendEvent(EV_KEY, code, 0);
+    appendEvent(EV_SYN, SYN_REPORT, 0);
+    if (shift) {
+        appendEvent(EV_KEY, KEY_LEFTSHIFT, 0);
+        appendEvent(EV_SYN, SYN_REPORT, 0);
+    }
+}
+
+void UinputBackend::appendStroke(const KeyStroke &stroke)
+{
+    if (stroke.flags & KeyStroke::Unicode) {
+        appendUnicode(stroke.code);
+    } else if (stroke.modifiers & KeyStroke::Control) {
+        appendEvent(EV_KEY, KEY_LEFTCTRL, 1);
+        appendEvent(EV_SYN, SYN_REPORT, 0);
+        appendTap(stroke.code, stroke.modifiers & KeyStroke::Shift);
+        appendEvent(EV_KEY, KEY_LEFTCTRL, 0);
+        appendEvent(EV_SYN, SYN_REPORT, 0);
+    } else {
+        appendTap(stroke.code, stroke.modifiers & KeyStroke::Shift);
+    }
+}
+
+void UinputBackend::appendUnicode(char32_t ucs4)
+{
+    // Ctrl+Shift+U, the hex digits, then Space to commit
+    appendEvent(EV_KEY, KEY_LEFTCTRL, 1);
+    appendEvent(EV_KEY, KEY_LEFTSHIFT, 1);
+    appendEvent(EV_SYN, SYN_REPORT, 0);
+    appendTap(KEY_U, false);
+    appendEvent(EV_KEY, KEY_LEFTSHIFT, 0);
+    appendEvent(EV_KEY, KEY_LEFTCTRL, 0);
+    appendEvent(EV_SYN, SYN_REPORT, 0);
+
+    for (QChar digit : QString::number(uint(ucs4), 16)) {
+        UsKey key = usKeyFor(digit.unicode());
+        appendTap(key.code, key.shift);
+    }
+    appendTap(KEY_SPACE, false);
+}
+
+bool UinputBackend::flushEvents()
+{
+    const char *data = events.constData();
+    qsizetype remaining = events.size();
+
+    while (remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qWarning("Failed to write uinput events: %s", strerror(errno));
+            SecureArena::wipe(events.data(), size_t(events.size()));
+            events.clear();
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+
+    // Key codes spell out the text
+    SecureArena::wipe(events.data(), size_t(events.size()));
+    events.clear();
+    return true;
+}
+
+void UinputBackend::compile(const QString &text, quint64 layout, KeystrokePlan &plan)
+{
+    plan.layout = layout;
+    plan.strokes.clear();
+    plan.strokes.reserve(size_t(text.size()));
+
+    for (int i = 0; i < text.size(); ++i) {
+        char32_t ucs4 = text.at(i).unicode();
+        if (text.at(i).isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            ucs4 = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+            ++i;
+        }
+
+        KeyStroke stroke;
+        UsKey key = usKeyFor(ucs4);
+        if (key.code != 0) {
+            stroke.code = key.code;
+            stroke.modifiers = key.shift ? KeyStroke::Shift : 0;
+        } else if (ucs4 >= 0xA0) {
+            stroke.code = ucs4;
+            stroke.flags = KeyStroke::Unicode;
+        } else {
+            continue; // Control characters without a key
+        }
+        plan.strokes.push_back(stroke);
+    }
+}
+
+KeyStroke UinputBackend::caretLeft()
+{
+    KeyStroke stroke;
+    stroke.code = KEY_LEFT;
+    return stroke;
+}
+
+KeyStroke UinputBackend::pasteKey()
+{
+    KeyStroke stroke;
+    stroke.code = KEY_V;
+    stroke.modifiers = KeyStroke::Control;
+    return stroke;
+}
+
+bool UinputBackend::sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                             const InjectionProgress &progress)
+{
+    if (!ensureDevice()) {
+        return false;
+    }
+
+    // Whole-text or oversized chunks are split to stay within the reader queues
+    int chunk = options.charsPerSubmit();
+    if (chunk <= 0 || chunk > MaxBurstChars) {
+        chunk = MaxBurstChars;
+    }
+    int pause = options.pauseUs();
+    if (pause <= 0 && chunk == MaxBurstChars) {
+        pause = 1000;
+    }
+
+    const int total = int(plan.strokes.size());
+    int pending = 0;
+    pacer.begin();
+    for (int i = 0; i < total; ++i) {
+        appendStroke(plan.strokes[i]);
+
+        // One write per chunk
+        if (++pending == chunk && i + 1 < total) {
+            if (!flushEvents()) {
+                return false;
+            }
+            pending = 0;
+            if (progress && !progress(i + 1, total)) {
+                return false;
+            }
+            // A stop is also picked up in the middle of a long pause
+            if (pause > 0 && !pacer.wait(pause, [&]() { return progress && !progress(i + 1, total); })) {
+                return false;
+            }
+        }
+    }
+
+    if (!flushEvents()) {
+        return false;
+    }
+    if (progress) {
+        progress(total, total);
+    }
+    return true;
+}
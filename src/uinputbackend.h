@@ -0,0 +1,38 @@
+#ifndef UINPUTBACKEND_H
+#define UINPUTBACKEND_H
+
+#include "injectionbackend.h"
+#include <QByteArray>
+
+// Injection through a virtual keyboard created with /dev/uinput. Works under
+// Wayland and on the console, but assumes a US QWERTY layout; other characters
+// are entered with the Ctrl+Shift+U Unicode sequence understood by GTK and IBus.
+class UinputBackend : public InjectionBackend
+{
+public:
+    UinputBackend();
+    ~UinputBackend() override;
+
+    QString name() const override { return "uinput"; }
+    bool isAvailable() const override;
+    // Plans always target US QWERTY, so there is a single layout
+    quint64 layoutId() override { return 0; }
+    void compile(const QString &text, quint64 layout, KeystrokePlan &plan) override;
+    KeyStroke caretLeft() override;
+    KeyStroke pasteKey() override;
+    bool sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                  const InjectionProgress &progress) override;
+
+private:
+    int fd;
+    QByteArray events;
+
+    bool ensureDevice();
+    void appendEvent(quint16 type, quint16 code, qint32 value);
+    void appendTap(quint16 code, bool shift);
+    void appendStroke(const KeyStroke &stroke);
+    void appendUnicode(char32_t ucs4);
+    bool flushEvents();
+};
+
+#endif // UINPUTBACKEND_H
@@ -0,0 +1,247 @@
+#include "vaultcrypto.h"
+#include <QCryptographicHash>
+#include <QStringDecoder>
+#include <QStringEncoder>
+#include <climits>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+namespace {
+
+const char TextPrefix[] = "gcm1:";
+const char DefaultPassphrase[] = "KeyGhostSecureKey123";
+
+// One cipher context per thread, reused so sealing a short snippet doesn't
+// allocate. The key schedule is rebuilt on every call.
+EVP_CIPHER_CTX *threadContext()
+{
+    struct Context {
+        EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+        ~Context() { EVP_CIPHER_CTX_free(ctx); }
+    };
+    thread_local Context context;
+    return context.ctx;
+}
+
+} // namespace
+
+VaultCrypto::VaultCrypto(const QByteArray &key)
+    : key(key)
+{
+    Q_ASSERT(key.size() == KeySize);
+    this->key.detach();
+}
+
+VaultCrypto::~VaultCrypto()
+{
+    OPENSSL_cleanse(key.data(), key.size());
+}
+
+bool VaultCrypto::seal(const char *plain, qsizetype size, char *out) const
+{
+    // EVP takes int lengths; snippets never come close
+    if (size < 0 || size > INT_MAX - Overhead) {
+        return false;
+    }
+
+    EVP_CIPHER_CTX *ctx = threadContext();
+    unsigned char *nonce = reinterpret_cast<unsigned char*>(out);
+    unsigned char *cipher = nonce + NonceSize;
+    unsigned char *tag = cipher + size;
+
+    if (RAND_bytes(nonce, NonceSize) != 1) {
+        return false;
+    }
+
+    int length = 0;
+    int finalLength = 0;
+    return EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                              reinterpret_cast<const unsigned char*>(key.constData()), nonce) == 1
+        && EVP_EncryptUpdate(ctx, cipher, &length,
+                             reinterpret_cast<const unsigned char*>(plain), int(size)) == 1
+        && EVP_EncryptFinal_ex(ctx, cipher + length, &finalLength) == 1
+        && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TagSize, tag) == 1;
+}
+
+bool VaultCrypto::open(const char *sealed, qsizetype size, char *out) const
+{
+    if (size < Overhead || size > INT_MAX) {
+        return false;
+    }
+
+    EVP_CIPHER_CTX *ctx = threadContext();
+    const unsigned char *nonce = reinterpret_cast<const unsigned char*>(sealed);
+    const unsigned char *cipher = nonce + NonceSize;
+    const int cipherSize = int(size - Overhead);
+    const unsigned char *tag = cipher + cipherSize;
+
+    int length = 0;
+    int finalLength = 0;
+    bool ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 reinterpret_cast<const unsigned char*>(key.constData()), nonce) == 1
+        && EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char*>(out), &length,
+                             cipher, cipherSize) == 1
+        && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TagSize,
+                               const_cast<unsigned char*>(tag)) == 1
+        && EVP_DecryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(out) + length, &finalLength) == 1;
+
+    if (!ok) {
+        // Don't leave unauthenticated plaintext behind
+        OPENSSL_cleanse(out, cipherSize);
+    }
+    return ok;
+}
+
+QByteArray VaultCrypto::encrypt(QByteArrayView plain) const
+{
+    QByteArray sealed(plain.size() + Overhead, Qt::Uninitialized);
+    if (!seal(plain.data(), plain.size(), sealed.data())) {
+        return QByteArray();
+    }
+    return sealed;
+}
+
+bool VaultCrypto::decrypt(QByteArrayView sealed, QByteArray &plain) const
+{
+    if (sealed.size() < Overhead) {
+        return false;
+    }
+
+    plain.resize(sealed.size() - Overhead);
+    if (!open(sealed.data(), sealed.size(), plain.data())) {
+        plain.clear();
+        return false;
+    }
+    return true;
+}
+
+QByteArray VaultCrypto::sealText(QStringView text) const
+{
+    if (text.isEmpty()) return QByteArray();
+
+    QStringEncoder encoder(QStringConverter::Utf8);
+    SecretBuffer plain(encoder.requiredSpace(text.size()));
+    if (plain.isEmpty()) return QByteArray();
+    plain.truncate(encoder.appendToBuffer(plain.data(), text) - plain.data());
+
+    return encrypt(QByteArrayView(plain.constData(), plain.size()));
+}
+
+bool VaultCrypto::openText(QByteArrayView sealed, SecretBuffer &text) const
+{
+    text.clear();
+    if (sealed.size() < Overhead) {
+        return false;
+    }
+    if (sealed.size() == Overhead) {
+        return true;
+    }
+
+    SecretBuffer plain(sealed.size() - Overhead);
+    if (plain.isEmpty() || !open(sealed.data(), sealed.size(), plain.data())) {
+        return false;
+    }
+
+    // Like QString::fromUtf8: a leading BOM is kept and bad sequences become U+FFFD
+    QStringDecoder decoder(QStringConverter::Utf8,
+                           QStringConverter::Flag::ConvertInitialBom | QStringConverter::Flag::Stateless);
+    SecretBuffer utf16(decoder.requiredSpace(plain.size()) * qsizetype(sizeof(QChar)));
+    if (utf16.isEmpty()) {
+        return false;
+    }
+    QChar *begin = reinterpret_cast<QChar*>(utf16.data());
+    QChar *end = decoder.appendToBuffer(begin, QByteArrayView(plain.constData(), plain.size()));
+    utf16.truncate((end - begin) * qsizetype(sizeof(QChar)));
+    text = std::move(utf16);
+    return true;
+}
+
+QString VaultCrypto::encryptText(const QString &text) const
+{
+    if (text.isEmpty()) return QString();
+
+    QByteArray plain = text.toUtf8();
+    QByteArray sealed = encrypt(plain);
+    OPENSSL_cleanse(plain.data(), plain.size());
+
+    if (sealed.isEmpty()) {
+        qWarning("Failed to encrypt snippet text");
+        return QString();
+    }
+    return QLatin1String(TextPrefix) + QString::fromLatin1(sealed.toBase64());
+}
+
+bool VaultCrypto::decryptText(const QString &encoded, QString &text) const
+{
+    text.clear();
+    if (encoded.isEmpty()) return true;
+
+    if (isLegacy(encoded)) {
+        text = legacyDecrypt(encoded);
+        return true;
+    }
+
+    QByteArray plain;
+    if (!decrypt(unwrapText(encoded), plain)) {
+        return false;
+    }
+
+    text = QString::fromUtf8(plain);
+    OPENSSL_cleanse(plain.data(), plain.size());
+    return true;
+}
+
+QByteArray VaultCrypto::unwrapText(const QString &encoded)
+{
+    return QByteArray::fromBase64(
+        QStringView(encoded).mid(int(sizeof(TextPrefix)) - 1).toLatin1());
+}
+
+QByteArray VaultCrypto::defaultKey()
+{
+    return QCryptographicHash::hash(DefaultPassphrase, QCryptographicHash::Sha256);
+}
+
+QByteArray VaultCrypto::generateKey()
+{
+    QByteArray key(KeySize, Qt::Uninitialized);
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(key.data()), KeySize) != 1) {
+        return QByteArray();
+    }
+    return key;
+}
+
+QByteArray VaultCrypto::wrapKey(const QByteArray &dataKey) const
+{
+    Q_ASSERT(dataKey.size() == KeySize);
+    return encrypt(dataKey);
+}
+
+bool VaultCrypto::unwrapKey(QByteArrayView wrapped, QByteArray &dataKey) const
+{
+    return wrapped.size() == WrappedKeySize && decrypt(wrapped, dataKey);
+}
+
+bool VaultCrypto::isLegacy(const QString &encoded)
+{
+    return !encoded.isEmpty() && !encoded.startsWith(QLatin1String(TextPrefix));
+}
+
+QString VaultCrypto::legacyDecrypt(const QString &encoded)
+{
+    QByteArray data = QByteArray::fromBase64(encoded.toUtf8());
+    if (data.size() < 16) return ""; // Not enough data for salt + content
+
+    // 16-byte salt, then the text XORed with SHA-256(passphrase + salt)
+    QByteArray keyMaterial = QByteArray(DefaultPassphrase) + data.left(16);
+    QByteArray stream = QCryptographicHash::hash(keyMaterial, QCryptographicHash::Sha256);
+
+    QByteArray result(data.size() - 16, Qt::Uninitialized);
+    const char *encrypted = data.constData() + 16;
+    for (qsizetype i = 0; i < result.size(); i++) {
+        result[i] = encrypted[i] ^ stream[i % stream.size()];
+    }
+
+    return QString::fromUtf8(result);
+}
@@ -0,0 +1,69 @@
+#ifndef VAULTCRYPTO_H
+#define VAULTCRYPTO_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include "securememory.h"
+
+// AES-256-GCM sealing of snippet text. OpenSSL picks the AES-NI/VAES and
+// carry-less multiply code paths at runtime when the CPU has them.
+// Instances are immutable and can be shared between threads.
+class VaultCrypto
+{
+public:
+    static const int KeySize = 32;
+    static const int NonceSize = 12;
+    static const int TagSize = 16;
+    static const int Overhead = NonceSize + TagSize;
+    static const int WrappedKeySize = KeySize + Overhead;
+
+    explicit VaultCrypto(const QByteArray &key);
+    ~VaultCrypto();
+
+    VaultCrypto(const VaultCrypto &) = delete;
+    VaultCrypto &operator=(const VaultCrypto &) = delete;
+
+    // Seals size bytes into out as nonce | ciphertext | tag. out must hold
+    // size + Overhead bytes and may not overlap the input.
+    bool seal(const char *plain, qsizetype size, char *out) const;
+
+    // Opens a sealed buffer into out, which must hold size - Overhead bytes.
+    // Fails if the data was modified or sealed with another key.
+    bool open(const char *sealed, qsizetype size, char *out) const;
+
+    // Convenience wrappers that allocate the result once at its final size
+    QByteArray encrypt(QByteArrayView plain) const;
+    bool decrypt(QByteArrayView sealed, QByteArray &plain) const;
+
+    // Snippet text sealed as UTF-8. The UTF-8 only ever exists in secure memory.
+    QByteArray sealText(QStringView text) const;
+    // Opens sealed UTF-8 into UTF-16 in secure memory, without other copies
+    bool openText(QByteArrayView sealed, SecretBuffer &text) const;
+
+    // Text form stored in the vault: "gcm1:" followed by the base64 sealed UTF-8
+    QString encryptText(const QString &text) const;
+    bool decryptText(const QString &encoded, QString &text) const;
+
+    // Sealed bytes of a "gcm1:" value, without decrypting them
+    static QByteArray unwrapText(const QString &encoded);
+
+    // Key derived from the built-in passphrase
+    static QByteArray defaultKey();
+
+    // Random data key, empty if the system has no entropy to give
+    static QByteArray generateKey();
+
+    // A data key sealed with this one as the master key, for the vault header
+    QByteArray wrapKey(const QByteArray &dataKey) const;
+    bool unwrapKey(QByteArrayView wrapped, QByteArray &dataKey) const;
+
+    // Values written before AES-GCM used a SHA-256 keystream XOR
+    static bool isLegacy(const QString &encoded);
+    static QString legacyDecrypt(const QString &encoded);
+
+private:
+    QByteArray key;
+};
+
+#endif // VAULTCRYPTO_H
@@ -0,0 +1,358 @@
+#include "vaultfile.h"
+#include "vaultcrypto.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const char Magic[4] = { 'K', 'G', 'V', '1' };
+const quint32 Version = 4;
+const qint64 HeaderSizeV3 = 16;
+
+// Version 4 adds the wrapped key size(4), 0 for none, and a slot for the key
+const qint64 HeaderSize = HeaderSizeV3 + 4 + VaultCrypto::WrappedKeySize;
+
+// id(4) modifiers(2) reserved(2) key(4) nameOffset(4) nameSize(4) bodySize(4) bodyOffset(8)
+// tagsOffset(4) tagsSize(4) tailOffset(4) tailSize(4). Version 1 entries stop
+// before the tags, version 2 entries before the hotkey tail.
+const qint64 EntrySize = 48;
+const qint64 EntrySizeV2 = 40;
+const qint64 EntrySizeV1 = 32;
+
+} // namespace
+
+VaultFile::VaultFile(const QString &path)
+    : filePath(path)
+    , data(nullptr)
+    , dataSize(0)
+{
+}
+
+VaultFile::~VaultFile()
+{
+    QMutexLocker locker(&mutex);
+    unmapLocked();
+}
+
+bool VaultFile::exists() const
+{
+    return QFile::exists(filePath);
+}
+
+bool VaultFile::load()
+{
+    QMutexLocker locker(&mutex);
+    unmapLocked();
+    if (!QFile::exists(filePath)) {
+        return false;
+    }
+    return mapLocked();
+}
+
+QList<VaultRecord> VaultFile::index() const
+{
+    QMutexLocker locker(&mutex);
+    QList<VaultRecord> records;
+    records.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        records.append(entry.record);
+    }
+    return records;
+}
+
+QByteArray VaultFile::body(int id) const
+{
+    QMutexLocker locker(&mutex);
+    return bodyLocked(id).toByteArray();
+}
+
+QByteArrayView VaultFile::bodyLocked(int id) const
+{
+    auto it = positions.constFind(id);
+    if (it == positions.constEnd()) {
+        return QByteArrayView();
+    }
+    const Entry &entry = entries[*it];
+    return QByteArrayView(reinterpret_cast<const char*>(data + entry.bodyOffset), entry.bodySize);
+}
+
+VaultFile::Reader::Reader(const VaultFile &vault)
+    : vault(vault)
+    , locker(&vault.mutex)
+{
+}
+
+bool VaultFile::save(const QList<VaultRecord> &records)
+{
+    QMutexLocker locker(&mutex);
+    return saveLocked(records, wrapped);
+}
+
+bool VaultFile::save(const QList<VaultRecord> &records, const QByteArray &wrappedKey)
+{
+    QMutexLocker locker(&mutex);
+    return saveLocked(records, wrappedKey);
+}
+
+QByteArray VaultFile::readWrappedKey(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QByteArray header = file.read(HeaderSize);
+    if (header.size() < HeaderSize || std::memcmp(header.constData(), Magic, sizeof(Magic)) != 0
+        || qFromLittleEndian<quint32>(header.constData() + 4) < 4) {
+        return QByteArray();
+    }
+    const quint32 size = qFromLittleEndian<quint32>(header.constData() + HeaderSizeV3);
+    if (size != quint32(VaultCrypto::WrappedKeySize)) {
+        return QByteArray();
+    }
+    return header.mid(HeaderSizeV3 + 4, size);
+}
+
+bool VaultFile::saveLocked(const QList<VaultRecord> &records, const QByteArray &wrappedKey)
+{
+    Q_ASSERT(wrappedKey.isEmpty() || wrappedKey.size() == VaultCrypto::WrappedKeySize);
+
+    // Bodies follow the index and names, so every offset is known before writing
+    QByteArray head(HeaderSize + records.size() * EntrySize, '\0');
+    QByteArray names;
+    QList<QByteArrayView> bodies;
+    bodies.reserve(records.size());
+
+    for (const VaultRecord &record : records) {
+        QByteArrayView body = record.body;
+        if (record.keepBody) {
+            auto it = positions.constFind(record.id);
+            if (it != positions.constEnd()) {
+                const Entry &entry = entries[*it];
+                body = QByteArrayView(reinterpret_cast<const char*>(data + entry.bodyOffset), entry.bodySize);
+            } else {
+                body = QByteArrayView();
+            }
+        }
+        bodies.append(body);
+    }
+
+    std::memcpy(head.data(), Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(Version, head.data() + 4);
+    qToLittleEndian<quint32>(quint32(records.size()), head.data() + 8);
+    qToLittleEndian<quint32>(quint32(wrappedKey.size()), head.data() + HeaderSizeV3);
+    std::memcpy(head.data() + HeaderSizeV3 + 4, wrappedKey.constData(), std::size_t(wrappedKey.size()));
+
+    QList<QByteArray> encodedNames;
+    QList<QByteArray> encodedTags;
+    QList<QByteArray> encodedTails;
+    encodedNames.reserve(records.size());
+    encodedTags.reserve(records.size());
+    encodedTails.reserve(records.size());
+    qint64 namesSize = 0;
+    for (const VaultRecord &record : records) {
+        encodedNames.append(record.name.toUtf8());
+        encodedTags.append(record.tags.join('\n').toUtf8());
+        encodedTails.append(record.hotkeyTail.toUtf8());
+        namesSize += encodedNames.last().size() + encodedTags.last().size() + encodedTails.last().size();
+    }
+    qToLittleEndian<quint32>(quint32(namesSize), head.data() + 12);
+
+    qint64 bodyOffset = head.size() + namesSize;
+    names.reserve(namesSize);
+    for (qsizetype i = 0; i < records.size(); i++) {
+        const VaultRecord &record = records[i];
+        char *p = head.data() + HeaderSize + i * EntrySize;
+        qToLittleEndian<qint32>(record.id, p);
+        qToLittleEndian<quint16>(quint16(record.hotkeyModifiers), p + 4);
+        qToLittleEndian<quint32>(quint32(record.hotkeyKey), p + 8);
+        qToLittleEndian<quint32>(quint32(names.size()), p + 12);
+        qToLittleEndian<quint32>(quint32(encodedNames[i].size()), p + 16);
+        qToLittleEndian<quint32>(quint32(bodies[i].size()), p + 20);
+        qToLittleEndian<quint64>(quint64(bodyOffset), p + 24);
+        names.append(encodedNames[i]);
+        qToLittleEndian<quint32>(quint32(names.size()), p + 32);
+        qToLittleEndian<quint32>(quint32(encodedTags[i].size()), p + 36);
+        names.append(encodedTags[i]);
+        qToLittleEndian<quint32>(quint32(names.size()), p + 40);
+        qToLittleEndian<quint32>(quint32(encodedTails[i].size()), p + 44);
+        names.append(encodedTails[i]);
+        bodyOffset += bodies[i].size();
+    }
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning("Failed to open vault file for writing: %s", qPrintable(out.errorString()));
+        return false;
+    }
+
+    out.write(head);
+    out.write(names);
+    for (QByteArrayView body : bodies) {
+        out.write(body.data(), body.size());
+    }
+
+    // The old mapping has to go before the new file can replace it
+    unmapLocked();
+    if (!out.commit()) {
+        qWarning("Failed to save vault file: %s", qPrintable(out.errorString()));
+        mapLocked();
+        return false;
+    }
+    wrapped = wrappedKey;
+    return mapLocked();
+}
+
+bool VaultFile::remove()
+{
+    QMutexLocker locker(&mutex);
+    unmapLocked();
+    return !QFile::exists(filePath) || QFile::remove(filePath);
+}
+
+bool VaultFile::importSettings(QSettings &settings, const VaultCrypto &crypto)
+{
+    QList<VaultRecord> records;
+    QSet<int> usedIds;
+
+    settings.beginGroup("Snippets");
+    const QStringList groups = settings.childGroups();
+    for (const QString &group : groups) {
+        settings.beginGroup(group);
+
+        VaultRecord record;
+        record.id = settings.value("Id", -1).toInt();
+        record.name = settings.value("Name").toString().trimmed();
+        record.hotkeyModifiers = settings.value("ModKeys", 0).toInt();
+        record.hotkeyKey = settings.value("Key", 0).toInt();
+        QString text = settings.value("Text").toString();
+        settings.endGroup();
+
+        if (record.name.isEmpty() || record.id < 0 || record.hotkeyKey == 0 || usedIds.contains(record.id)) {
+            qWarning("Not importing an invalid snippet: name='%s', id=%d", qPrintable(record.name), record.id);
+            continue;
+        }
+        usedIds.insert(record.id);
+
+        // GCM values are moved over still sealed; legacy ones are sealed now
+        if (VaultCrypto::isLegacy(text)) {
+            QByteArray plain = VaultCrypto::legacyDecrypt(text).toUtf8();
+            record.body = crypto.encrypt(plain);
+            plain.fill('\0');
+        } else if (!text.isEmpty()) {
+            record.body = VaultCrypto::unwrapText(text);
+        }
+        records.append(record);
+    }
+    settings.endGroup();
+
+    qInfo("Importing %lld snippets into %s", qlonglong(records.size()), qPrintable(filePath));
+    return save(records);
+}
+
+QString VaultFile::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/snippets.kgv";
+}
+
+bool VaultFile::mapLocked()
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("Failed to open vault file: %s", qPrintable(file.errorString()));
+        return false;
+    }
+
+    dataSize = file.size();
+    data = dataSize >= HeaderSizeV3 ? file.map(0, dataSize) : nullptr;
+    const quint32 version = data ? qFromLittleEndian<quint32>(data + 4) : 0;
+    const qint64 headerSize = version < 4 ? HeaderSizeV3 : HeaderSize;
+    if (!data || std::memcmp(data, Magic, sizeof(Magic)) != 0 || version < 1 || version > Version
+        || dataSize < headerSize) {
+        qWarning("%s is not a KeyGhost vault", qPrintable(filePath));
+        unmapLocked();
+        return false;
+    }
+
+    // Older vaults were sealed with the master key
+    wrapped.clear();
+    if (version >= 4) {
+        const quint32 wrappedSize = qFromLittleEndian<quint32>(data + HeaderSizeV3);
+        if (wrappedSize != 0 && wrappedSize != quint32(VaultCrypto::WrappedKeySize)) {
+            qWarning("Vault file %s has a damaged key", qPrintable(filePath));
+            unmapLocked();
+            return false;
+        }
+        wrapped = QByteArray(reinterpret_cast<const char*>(data + HeaderSizeV3 + 4), wrappedSize);
+    }
+
+    const quint32 count = qFromLittleEndian<quint32>(data + 8);
+    const qint64 entrySize = version == 1 ? EntrySizeV1 : version == 2 ? EntrySizeV2 : EntrySize;
+    const qint64 namesStart = headerSize + qint64(count) * entrySize;
+    const qint64 namesEnd = namesStart + qFromLittleEndian<quint32>(data + 12);
+    if (namesEnd > dataSize) {
+        qWarning("Vault file %s is truncated", qPrintable(filePath));
+        unmapLocked();
+        return false;
+    }
+
+    entries.reserve(count);
+    for (quint32 i = 0; i < count; i++) {
+        const uchar *p = data + headerSize + qint64(i) * entrySize;
+        const qint64 nameOffset = namesStart + qFromLittleEndian<quint32>(p + 12);
+        const qint64 nameSize = qFromLittleEndian<quint32>(p + 16);
+        const qint64 bodySize = qFromLittleEndian<quint32>(p + 20);
+        const quint64 bodyOffset = qFromLittleEndian<quint64>(p + 24);
+        const qint64 tagsOffset = namesStart + (version == 1 ? 0 : qFromLittleEndian<quint32>(p + 32));
+        const qint64 tagsSize = version == 1 ? 0 : qFromLittleEndian<quint32>(p + 36);
+        const qint64 tailOffset = namesStart + (version < 3 ? 0 : qFromLittleEndian<quint32>(p + 40));
+        const qint64 tailSize = version < 3 ? 0 : qFromLittleEndian<quint32>(p + 44);
+
+        Entry entry;
+        entry.record.id = qFromLittleEndian<qint32>(p);
+        entry.record.hotkeyModifiers = qFromLittleEndian<quint16>(p + 4);
+        entry.record.hotkeyKey = int(qFromLittleEndian<quint32>(p + 8));
+        entry.record.keepBody = true;
+        entry.bodyOffset = qint64(bodyOffset);
+        entry.bodySize = bodySize;
+
+        if (nameOffset + nameSize > namesEnd || tagsOffset + tagsSize > namesEnd
+            || tailOffset + tailSize > namesEnd
+            || bodyOffset < quint64(namesEnd)
+            || bodyOffset > quint64(dataSize) || entry.bodyOffset + bodySize > dataSize
+            || entry.record.id < 0 || positions.contains(entry.record.id)) {
+            qWarning("Skipping damaged vault record %u", i);
+            continue;
+        }
+
+        entry.record.name = QString::fromUtf8(reinterpret_cast<const char*>(data + nameOffset), nameSize);
+        if (tagsSize > 0) {
+            entry.record.tags = QString::fromUtf8(reinterpret_cast<const char*>(data + tagsOffset), tagsSize)
+                                    .split('\n', Qt::SkipEmptyParts);
+        }
+        if (tailSize > 0) {
+            entry.record.hotkeyTail = QString::fromUtf8(reinterpret_cast<const char*>(data + tailOffset), tailSize);
+        }
+        positions.insert(entry.record.id, entries.size());
+        entries.append(entry);
+    }
+    return true;
+}
+
+void VaultFile::unmapLocked()
+{
+    if (data) {
+        file.unmap(const_cast<uchar*>(data));
+    }
+    data = nullptr;
+    dataSize = 0;
+    file.close();
+    entries.clear();
+    positions.clear();
+}
@@ -0,0 +1,122 @@
+#ifndef VAULTFILE_H
+#define VAULTFILE_H
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class QSettings;
+class VaultCrypto;
+
+// One snippet as stored in the vault. The body is the sealed text.
+struct VaultRecord
+{
+    int id = -1;
+    QString name;
+    int hotkeyModifiers = 0;
+    int hotkeyKey = 0;
+    QStringList tags;
+    QString hotkeyTail;    // Rest of a hotkey sequence, QKeySequence portable text
+    QByteArray body;
+    bool keepBody = false; // Save copies the body currently stored under id
+};
+
+// Single-file snippet vault, mapped into memory. Layout (little endian):
+//
+//   header   "KGV1", version, record count, size of the names block, the
+//            wrapped data key if the vault has one
+//   index    one fixed-size entry per record: id, hotkey, name, tags, hotkey tail
+//            and body location
+//   names    UTF-8 names, newline-separated tags and hotkey tails referenced by the index
+//   bodies   sealed texts, only touched when a text is read
+//
+// Loading parses the header, index and names only. Saves build a new file next
+// to the old one and rename it over, copying unchanged bodies from the mapping.
+// Bodies are sealed with the data key wrapped in the header, or directly with
+// the master key if there is none. All methods are thread-safe.
+class VaultFile
+{
+public:
+    explicit VaultFile(const QString &path);
+    ~VaultFile();
+
+    VaultFile(const VaultFile &) = delete;
+    VaultFile &operator=(const VaultFile &) = delete;
+
+    QString path() const { return filePath; }
+    bool exists() const;
+
+    // Maps the file and reads its index; false if it is missing or corrupt
+    bool load();
+
+    // Records in file order, with empty bodies and keepBody set
+    QList<VaultRecord> index() const;
+
+    // Copy of the sealed text stored for id
+    QByteArray body(int id) const;
+
+    // Reads bodies straight from the mapping, from any number of threads
+    // without further locking. Saves wait while a reader lives, so keep one
+    // to a batch.
+    class Reader
+    {
+    public:
+        explicit Reader(const VaultFile &vault);
+
+        // Sealed text stored for id, valid while the reader lives
+        QByteArrayView body(int id) const { return vault.bodyLocked(id); }
+
+    private:
+        Q_DISABLE_COPY(Reader)
+
+        const VaultFile &vault;
+        QMutexLocker<QMutex> locker;
+    };
+
+    // Replaces the vault with records and maps the new file
+    bool save(const QList<VaultRecord> &records);
+    // Same, with bodies sealed under a new data key. A crash leaves either the
+    // old or the new file in place, never a mix of both keys.
+    bool save(const QList<VaultRecord> &records, const QByteArray &wrappedKey);
+
+    // Wrapped data key from the header of the vault at path, reading nothing
+    // else; empty if bodies are sealed with the master key
+    static QByteArray readWrappedKey(const QString &path);
+
+    // Unmaps and deletes the file
+    bool remove();
+
+    // Converts the Snippets group written by older versions and saves it
+    bool importSettings(QSettings &settings, const VaultCrypto &crypto);
+
+    // <app data>/snippets.kgv
+    static QString defaultPath();
+
+private:
+    struct Entry
+    {
+        VaultRecord record;
+        qint64 bodyOffset = 0;
+        qint64 bodySize = 0;
+    };
+
+    QByteArrayView bodyLocked(int id) const;
+    bool saveLocked(const QList<VaultRecord> &records, const QByteArray &wrappedKey);
+    bool mapLocked();
+    void unmapLocked();
+
+    mutable QMutex mutex;
+    QString filePath;
+    QFile file;
+    const uchar *data;
+    qint64 dataSize;
+    QByteArray wrapped;     // Kept across remove(), so saves stay on the current data key
+    QList<Entry> entries;
+    QHash<int, qsizetype> positions;
+};
+
+#endif // VAULTFILE_H
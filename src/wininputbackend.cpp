@@ -0,0 +1,186 @@
+#include "wininputbackend.h"
+#include <QScopeGuard>
+
+namespace {
+
+// Packed layout table entry: VK in bits 0-7, KeyStroke modifiers in bits 8-10
+const quint32 EntryResolved = 0x80000000;
+const quint32 EntryUnicode  = 0x00010000;
+
+} // namespace
+
+quint64 WinInputBackend::layoutId()
+{
+    // Keystrokes are interpreted with the layout of the window that receives them
+    HWND foreground = GetForegroundWindow();
+    DWORD thread = foreground ? GetWindowThreadProcessId(foreground, nullptr) : 0;
+    return quint64(quintptr(GetKeyboardLayout(thread)));
+}
+
+KeyStroke WinInputBackend::lookup(std::vector<quint32> &table, HKL layout, char16_t unit)
+{
+    quint32 &entry = table[unit];
+
+    if (!(entry & EntryResolved)) {
+        entry = EntryResolved;
+
+        SHORT vkScan = -1;
+        if (unit == '\n' || unit == '\r') {
+            // VkKeyScan maps '\n' to Ctrl+Enter, which submits forms in many apps
+            vkScan = VK_RETURN;
+        } else if (!QChar::isSurrogate(unit)) {
+            vkScan = VkKeyScanExW(unit, layout);
+        }
+
+        // Low byte is the VK, high byte the Shift/Ctrl/Alt state. Hankaku and
+        // the reserved states can't be synthesised, so those use Unicode input.
+        BYTE vkCode = LOBYTE(vkScan);
+        BYTE shiftState = HIBYTE(vkScan);
+        if (vkScan == -1 || vkCode == 0xFF || (shiftState & ~0x07)) {
+            entry |= EntryUnicode;
+        } else {
+            entry |= vkCode | (quint32(shiftState) << 8);
+        }
+    }
+
+    KeyStroke stroke;
+    if (entry & EntryUnicode) {
+        stroke.code = unit;
+        stroke.flags = KeyStroke::Unicode;
+    } else {
+        stroke.code = entry & 0xFF;
+        stroke.modifiers = (entry >> 8) & 0x07;
+    }
+    return stroke;
+}
+
+void WinInputBackend::compile(const QString &text, quint64 layout, KeystrokePlan &plan)
+{
+    std::vector<quint32> &table = layoutTables[layout];
+    if (table.empty()) {
+        table.assign(0x10000, 0);
+    }
+
+    plan.layout = layout;
+    plan.strokes.clear();
+    plan.strokes.reserve(size_t(text.size()));
+
+    // Surrogate pairs become two Unicode strokes, which SendInput accepts as is
+    HKL hkl = HKL(quintptr(layout));
+    for (QChar c : text) {
+        plan.strokes.push_back(lookup(table, hkl, c.unicode()));
+    }
+}
+
+KeyStroke WinInputBackend::caretLeft()
+{
+    KeyStroke stroke;
+    stroke.code = VK_LEFT;
+    return stroke;
+}
+
+KeyStroke WinInputBackend::pasteKey()
+{
+    KeyStroke stroke;
+    stroke.code = 'V';
+    stroke.modifiers = KeyStroke::Control;
+    return stroke;
+}
+
+bool WinInputBackend::modifiersHeld()
+{
+    for (int vk : { VK_SHIFT, VK_CONTROL, VK_MENU, VK_LWIN, VK_RWIN }) {
+        if (GetAsyncKeyState(vk) & 0x8000) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WinInputBackend::appendKey(WORD vk, WORD scan, DWORD flags)
+{
+    INPUT input;
+    ZeroMemory(&input, sizeof(INPUT));
+    input.type = INPUT_KEYBOARD;
+    input.ki.wVk = vk;
+    input.ki.wScan = scan;
+    input.ki.dwFlags = flags;
+    inputs.push_back(input);
+}
+
+void WinInputBackend::appendStroke(const KeyStroke &stroke)
+{
+    if (stroke.flags & KeyStroke::Unicode) {
+        // Character can't be typed with a normal keystroke
+        // Use the KEYEVENTF_UNICODE flag for direct Unicode input
+        appendKey(0, WORD(stroke.code), KEYEVENTF_UNICODE);
+        appendKey(0, WORD(stroke.code), KEYEVENTF_UNICODE | KEYEVENTF_KEYUP);
+        return;
+    }
+
+    // Ctrl+Alt stands in for AltGr
+    if (stroke.modifiers & KeyStroke::Shift)   appendKey(VK_SHIFT, 0, 0);
+    if (stroke.modifiers & KeyStroke::Control) appendKey(VK_CONTROL, 0, 0);
+    if (stroke.modifiers & KeyStroke::Alt)     appendKey(VK_MENU, 0, 0);
+
+    appendKey(WORD(stroke.code), 0, 0);
+    appendKey(WORD(stroke.code), 0, KEYEVENTF_KEYUP);
+
+    if (stroke.modifiers & KeyStroke::Alt)     appendKey(VK_MENU, 0, KEYEVENTF_KEYUP);
+    if (stroke.modifiers & KeyStroke::Control) appendKey(VK_CONTROL, 0, KEYEVENTF_KEYUP);
+    if (stroke.modifiers & KeyStroke::Shift)   appendKey(VK_SHIFT, 0, KEYEVENTF_KEYUP);
+}
+
+bool WinInputBackend::sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                               const InjectionProgress &progress)
+{
+    // clear() keeps the capacity; a stroke needs at most eight events.
+    // The events spell out the text, so they're wiped after every send.
+    auto wipeInputs = qScopeGuard([this]() {
+        SecureArena::wipe(inputs.data(), inputs.size() * sizeof(INPUT));
+        inputs.clear();
+    });
+    inputs.clear();
+    strokeEnds.clear();
+    inputs.reserve(plan.strokes.size() * 8);
+    strokeEnds.reserve(plan.strokes.size());
+
+    for (const KeyStroke &stroke : plan.strokes) {
+        appendStroke(stroke);
+        strokeEnds.push_back(inputs.size());
+    }
+
+    const size_t strokeCount = strokeEnds.size();
+    const size_t chunk = options.charsPerSubmit() > 0 ? size_t(options.charsPerSubmit()) : strokeCount;
+    const int pause = options.pauseUs();
+
+    pacer.begin();
+    size_t first = 0;
+    size_t typed = 0;
+    while (typed < strokeCount) {
+        size_t next = qMin(typed + chunk, strokeCount);
+        size_t last = strokeEnds[next - 1];
+
+        // One SendInput call per chunk; it fails as a whole if the input is blocked
+        UINT count = UINT(last - first);
+        if (SendInput(count, inputs.data() + first, sizeof(INPUT)) != count) {
+            qWarning("SendInput was blocked after %zu of %zu characters", typed, strokeCount);
+            return false;
+        }
+
+        first = last;
+        typed = next;
+
+        if (progress && !progress(int(typed), int(strokeCount))) {
+            return false;
+        }
+
+        // A stop is also picked up in the middle of a long pause
+        if (pause > 0 && typed < strokeCount
+            && !pacer.wait(pause, [&]() { return progress && !progress(int(typed), int(strokeCount)); })) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef WININPUTBACKEND_H
+#define WININPUTBACKEND_H
+
+#include "injectionbackend.h"
+#include <QHash>
+#include <vector>
+#include <Windows.h>
+
+// Injection through the Win32 SendInput API. Plans are expanded into one
+// INPUT buffer up front and handed to SendInput in chunks.
+class WinInputBackend : public InjectionBackend
+{
+public:
+    QString name() const override { return "sendinput"; }
+    bool isAvailable() const override { return true; }
+    quint64 layoutId() override;
+    void compile(const QString &text, quint64 layout, KeystrokePlan &plan) override;
+    KeyStroke caretLeft() override;
+    KeyStroke pasteKey() override;
+    bool modifiersHeld() override;
+    bool sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                  const InjectionProgress &progress) override;
+
+private:
+    // Per-layout lookup: one packed entry per BMP code unit, filled in with
+    // VkKeyScanExW the first time the unit is seen
+    QHash<quint64, std::vector<quint32>> layoutTables;
+
+    // Reused between sends so a warm backend doesn't allocate
+    std::vector<INPUT, SecureAllocator<INPUT>> inputs;
+    // End offset in inputs of each stroke's events
+    std::vector<size_t> strokeEnds;
+
+    KeyStroke lookup(std::vector<quint32> &table, HKL layout, char16_t unit);
+    void appendKey(WORD vk, WORD scan, DWORD flags);
+    void appendStroke(const KeyStroke &stroke);
+};
+
+#endif // WININPUTBACKEND_H
@@ -0,0 +1,364 @@
+#include "xtestbackend.h"
+
+// Xlib defines macros such as None and Bool that clash with Qt, include it last
+#include <X11/Xlib.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+
+namespace {
+
+// Without chunks, a stop is checked after this many strokes
+const int CancelCheckStrokes = 64;
+
+// Maps a code point to its X keysym, NoSymbol for control characters we can't type
+KeySym keysymForCodePoint(char32_t ucs4)
+{
+    switch (ucs4) {
+    case '\n':
+    case '\r':
+        return XK_Return;
+    case '\t':
+        return XK_Tab;
+    case '\b':
+        return XK_BackSpace;
+    }
+
+    if (ucs4 < 0x20 || (ucs4 >= 0x7F && ucs4 < 0xA0)) {
+        return NoSymbol;
+    }
+
+    // Latin-1 keysyms equal their code points, everything else uses the Unicode range
+    if (ucs4 <= 0xFF) {
+        return ucs4;
+    }
+    return 0x01000000 | ucs4;
+}
+
+} // namespace
+
+XTestBackend::XTestBackend()
+    : display(nullptr)
+    , xkbEventBase(-1)
+    , shiftKeycode(0)
+    , controlKeycode(0)
+    , mappingSerial(0)
+    , keymapLayout(~quint64(0))
+    , scratchUsed(0)
+    , scratchHighWater(0)
+{
+    if (qEnvironmentVariableIsEmpty("DISPLAY")) {
+        return;
+    }
+
+    display = XOpenDisplay(nullptr);
+    if (!display) {
+        qWarning("Failed to open X display for XTest injection");
+        return;
+    }
+
+    int eventBase, errorBase, major, minor;
+    if (!XTestQueryExtension(display, &eventBase, &errorBase, &major, &minor)) {
+        qWarning("XTEST extension is not available on this display");
+        XCloseDisplay(display);
+        display = nullptr;
+        return;
+    }
+
+    // Keymap and keyboard replacement notifications tell us when cached plans go stale
+    int opcode;
+    major = XkbMajorVersion;
+    minor = XkbMinorVersion;
+    if (XkbQueryExtension(display, &opcode, &xkbEventBase, &errorBase, &major, &minor)) {
+        unsigned int events = XkbMapNotifyMask | XkbNewKeyboardNotifyMask;
+        XkbSelectEvents(display, XkbUseCoreKbd, events, events);
+    } else {
+        xkbEventBase = -1;
+    }
+
+    // Keep delivering events even while another client holds a server grab
+    XTestGrabControl(display, True);
+    shiftKeycode = XKeysymToKeycode(display, XK_Shift_L);
+    controlKeycode = XKeysymToKeycode(display, XK_Control_L);
+}
+
+XTestBackend::~XTestBackend()
+{
+    if (display) {
+        XCloseDisplay(display);
+    }
+}
+
+bool XTestBackend::isScratchRange(int first, int count) const
+{
+    for (int code = first; code < first + count; ++code) {
+        if (!scratchKeycodes.contains(static_cast<unsigned char>(code))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+quint64 XTestBackend::layoutId()
+{
+    if (!display) {
+        return 0;
+    }
+
+    // Change notifications queue up on our connection, drain them without blocking.
+    // Rebinding scratch keycodes notifies too, but doesn't change the layout.
+    while (XPending(display) > 0) {
+        XEvent event;
+        XNextEvent(display, &event);
+
+        if (event.type == MappingNotify) {
+            if (event.xmapping.request == MappingKeyboard
+                && !isScratchRange(event.xmapping.first_keycode, event.xmapping.count)) {
+                ++mappingSerial;
+            }
+            XRefreshKeyboardMapping(&event.xmapping);
+        } else if (xkbEventBase >= 0 && event.type == xkbEventBase) {
+            const XkbEvent *xkbEvent = reinterpret_cast<const XkbEvent*>(&event);
+            if (xkbEvent->any.xkb_type == XkbNewKeyboardNotify) {
+                ++mappingSerial;
+            } else if (xkbEvent->any.xkb_type == XkbMapNotify
+                       && !isScratchRange(xkbEvent->map.first_key_sym, xkbEvent->map.num_key_syms)) {
+                ++mappingSerial;
+            }
+        }
+    }
+
+    // Switching layouts changes the active XKB group rather than the keymap
+    XkbStateRec state;
+    if (XkbGetState(display, XkbUseCoreKbd, &state) != Success) {
+        state.group = 0;
+    }
+
+    return (mappingSerial << 8) | state.group;
+}
+
+void XTestBackend::loadKeymap(quint64 layout)
+{
+    keymap.clear();
+    scratchKeycodes.clear();
+    keymapLayout = layout;
+
+    XkbDescPtr xkb = XkbGetMap(display, XkbKeyTypesMask | XkbKeySymsMask, XkbUseCoreKbd);
+    if (!xkb) {
+        return;
+    }
+
+    const int group = int(layout & 0xFF);
+    for (int code = xkb->min_key_code; code <= xkb->max_key_code; ++code) {
+        int groups = XkbKeyNumGroups(xkb, code);
+        if (groups == 0) {
+            scratchKeycodes.append(code);
+            continue;
+        }
+
+        // Keys with fewer groups wrap around, like the server does by default.
+        // Only the plain and Shift levels are used, the rest go through scratch keycodes.
+        int keyGroup = group % groups;
+        int width = qMin(int(XkbKeyGroupWidth(xkb, code, keyGroup)), 2);
+        for (int level = 0; level < width; ++level) {
+            KeySym keysym = XkbKeySymEntry(xkb, code, level, keyGroup);
+            if (keysym != NoSymbol && !keymap.contains(keysym)) {
+                keymap.insert(keysym, quint16(code) | (level ? 0x100 : 0));
+            }
+        }
+    }
+
+    XkbFreeKeyboard(xkb, 0, True);
+}
+
+void XTestBackend::compile(const QString &text, quint64 layout, KeystrokePlan &plan)
+{
+    if (keymapLayout != layout) {
+        loadKeymap(layout);
+    }
+
+    plan.layout = layout;
+    plan.strokes.clear();
+    plan.strokes.reserve(size_t(text.size()));
+
+    for (int i = 0; i < text.size(); ++i) {
+        char32_t ucs4 = text.at(i).unicode();
+        if (text.at(i).isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            ucs4 = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+            ++i;
+        }
+
+        KeySym keysym = keysymForCodePoint(ucs4);
+        if (keysym == NoSymbol) {
+            continue;
+        }
+
+        KeyStroke stroke;
+        auto mapped = keymap.constFind(keysym);
+        if (mapped != keymap.constEnd()) {
+            stroke.code = *mapped & 0xFF;
+            stroke.modifiers = (*mapped & 0x100) ? KeyStroke::Shift : 0;
+        } else {
+            // Bound to a scratch keycode when the plan is sent
+            stroke.code = quint32(keysym);
+            stroke.flags = KeyStroke::Unicode;
+        }
+        plan.strokes.push_back(stroke);
+    }
+}
+
+KeyStroke XTestBackend::caretLeft()
+{
+    KeyStroke stroke;
+    if (display) {
+        stroke.code = XKeysymToKeycode(display, XK_Left);
+    }
+    return stroke;
+}
+
+KeyStroke XTestBackend::pasteKey()
+{
+    KeyStroke stroke;
+    if (display) {
+        stroke.code = XKeysymToKeycode(display, XK_v);
+        stroke.modifiers = KeyStroke::Control;
+    }
+    return stroke;
+}
+
+bool XTestBackend::modifiersHeld()
+{
+    if (!display) {
+        return false;
+    }
+
+    char keys[32];
+    XQueryKeymap(display, keys);
+    for (KeySym keysym : { XK_Shift_L, XK_Shift_R, XK_Control_L, XK_Control_R,
+                           XK_Alt_L, XK_Alt_R, XK_Super_L, XK_Super_R }) {
+        KeyCode code = XKeysymToKeycode(display, keysym);
+        if (code != 0 && (keys[code / 8] & (1 << (code % 8)))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void XTestBackend::tapKey(unsigned char keycode, quint16 modifiers)
+{
+    if (modifiers & KeyStroke::Control) {
+        XTestFakeKeyEvent(display, controlKeycode, True, CurrentTime);
+    }
+    if (modifiers & KeyStroke::Shift) {
+        XTestFakeKeyEvent(display, shiftKeycode, True, CurrentTime);
+    }
+    XTestFakeKeyEvent(display, keycode, True, CurrentTime);
+    XTestFakeKeyEvent(display, keycode, False, CurrentTime);
+    if (modifiers & KeyStroke::Shift) {
+        XTestFakeKeyEvent(display, shiftKeycode, False, CurrentTime);
+    }
+    if (modifiers & KeyStroke::Control) {
+        XTestFakeKeyEvent(display, controlKeycode, False, CurrentTime);
+    }
+}
+
+unsigned char XTestBackend::bindScratch(unsigned long keysym)
+{
+    auto bound = scratchBound.constFind(keysym);
+    if (bound != scratchBound.constEnd()) {
+        return *bound;
+    }
+
+    if (scratchKeycodes.isEmpty()) {
+        return 0;
+    }
+
+    if (scratchUsed == scratchKeycodes.size()) {
+        // Every spare keycode is taken: let the server process the queued
+        // presses before their keycodes get a new meaning
+        XSync(display, False);
+        scratchBound.clear();
+        scratchUsed = 0;
+    }
+
+    unsigned char keycode = scratchKeycodes.at(scratchUsed++);
+    scratchHighWater = qMax(scratchHighWater, scratchUsed);
+
+    KeySym syms[2] = { keysym, keysym };
+    XChangeKeyboardMapping(display, keycode, 2, syms, 1);
+    scratchBound.insert(keysym, keycode);
+    return keycode;
+}
+
+void XTestBackend::releaseScratch()
+{
+    KeySym syms[2] = { NoSymbol, NoSymbol };
+    for (int i = 0; i < scratchHighWater; ++i) {
+        XChangeKeyboardMapping(display, scratchKeycodes.at(i), 2, syms, 1);
+    }
+    if (scratchHighWater > 0) {
+        XFlush(display);
+    }
+
+    scratchBound.clear();
+    scratchUsed = 0;
+    scratchHighWater = 0;
+}
+
+bool XTestBackend::sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                            const InjectionProgress &progress)
+{
+    if (!display) {
+        return false;
+    }
+
+    const int total = int(plan.strokes.size());
+    const int chunk = options.charsPerSubmit();
+    const int pause = options.pauseUs();
+    int pending = 0;
+    pacer.begin();
+
+    for (int i = 0; i < total; ++i) {
+        const KeyStroke &stroke = plan.strokes[i];
+
+        if (stroke.flags & KeyStroke::Unicode) {
+            unsigned char keycode = bindScratch(stroke.code);
+            if (!keycode) {
+                qWarning("No spare keycode to type keysym 0x%x", unsigned(stroke.code));
+            } else {
+                tapKey(keycode, 0);
+            }
+        } else {
+            tapKey(stroke.code, stroke.modifiers);
+        }
+
+        if (chunk > 0 && ++pending == chunk && i + 1 < total) {
+            XFlush(display);
+            pending = 0;
+            if (progress && !progress(i + 1, total)) {
+                XSync(display, False);
+                releaseScratch();
+                return false;
+            }
+            // A stop is also picked up in the middle of a long pause
+            if (pause > 0 && !pacer.wait(pause, [&]() { return progress && !progress(i + 1, total); })) {
+                XSync(display, False);
+                releaseScratch();
+                return false;
+            }
+        } else if (chunk <= 0 && (i + 1) % CancelCheckStrokes == 0 && i + 1 < total
+                   && progress && !progress(i + 1, total)) {
+            XSync(display, False);
+            releaseScratch();
+            return false;
+        }
+    }
+
+    // Single round-trip: returns once the server has processed every queued event
+    XSync(display, False);
+    releaseScratch();
+    if (progress) {
+        progress(total, total);
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef XTESTBACKEND_H
+#define XTESTBACKEND_H
+
+#include "injectionbackend.h"
+#include <QHash>
+#include <QVector>
+
+typedef struct _XDisplay Display;
+
+// Injection through the X11 XTEST extension. Events are queued in Xlib's
+// output buffer and flushed once per chunk, so a snippet sent as one chunk
+// costs a single round-trip.
+class XTestBackend : public InjectionBackend
+{
+public:
+    XTestBackend();
+    ~XTestBackend() override;
+
+    QString name() const override { return "xtest"; }
+    bool isAvailable() const override { return display != nullptr; }
+    quint64 layoutId() override;
+    void compile(const QString &text, quint64 layout, KeystrokePlan &plan) override;
+    KeyStroke caretLeft() override;
+    KeyStroke pasteKey() override;
+    bool modifiersHeld() override;
+    bool sendPlan(const KeystrokePlan &plan, const InjectionOptions &options,
+                  const InjectionProgress &progress) override;
+
+private:
+    Display *display;
+    int xkbEventBase;
+    unsigned char shiftKeycode;
+    unsigned char controlKeycode;
+
+    // Bumped whenever the server reports a keymap change we didn't cause
+    quint64 mappingSerial;
+
+    // Keysym -> keycode in the low byte, bit 8 set when Shift is needed,
+    // valid for the layout in keymapLayout
+    QHash<unsigned long, quint16> keymap;
+    quint64 keymapLayout;
+
+    // Keycodes without any keysym, borrowed for characters missing from the layout
+    QVector<unsigned char> scratchKeycodes;
+    QHash<unsigned long, unsigned char> scratchBound;
+    int scratchUsed;
+    int scratchHighWater;
+
+    void loadKeymap(quint64 layout);
+    bool isScratchRange(int first, int count) const;
+    void tapKey(unsigned char keycode, quint16 modifiers);
+    unsigned char bindScratch(unsigned long keysym);
+    void releaseScratch();
+};
+
+#endif // XTESTBACKEND_H